@@ -0,0 +1,313 @@
+#define NOMINMAX
+#include <windows.h>
+#include <GL/gl.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+
+#include "capture.hpp"
+
+
+//-------------------------------------------------------
+//	frame ring shared by render and writer threads
+//-------------------------------------------------------
+
+namespace Capture
+{
+	namespace
+	{
+		constexpr int ringSize = 8;
+		constexpr int bytesPerPixel = 3;
+
+
+		struct Frame
+		{
+			std::vector< unsigned char > pixels;
+			uint32_t index = 0;
+		};
+
+
+		int frameWidth = 0;
+		int frameHeight = 0;
+
+		bool active = false;
+		Format format = Format::ppmSequence;
+		std::string prefix;
+
+		// single producer (render thread), single consumer (writer thread)
+		std::array< Frame, ringSize > ring;
+		std::atomic< uint32_t > producedFrames{ 0 };
+		std::atomic< uint32_t > consumedFrames{ 0 };
+		std::atomic< int > dropped{ 0 };
+		uint32_t frameIndex = 0;
+
+		// writer thread only until it's joined
+		int failed = 0;
+
+		std::thread writer;
+		std::mutex writerMutex;
+		std::condition_variable writerWakeUp;
+		bool writerQuit = false;
+	}
+}
+
+
+//-------------------------------------------------------
+//	writer thread
+//-------------------------------------------------------
+
+namespace Capture
+{
+	namespace
+	{
+		int rowBytes()
+		{
+			return frameWidth * bytesPerPixel;
+		}
+
+
+		// GL rows go bottom to top, files store them top to bottom
+		const unsigned char* fileRow( Frame const& frame, int row )
+		{
+			return &frame.pixels[( frameHeight - 1 - row ) * rowBytes()];
+		}
+
+
+		bool writePPM( Frame const& frame )
+		{
+			char fileName[512];
+			std::snprintf( fileName, sizeof( fileName ), "%s_%06u.ppm", prefix.c_str(), unsigned( frame.index ) );
+
+			FILE* file = std::fopen( fileName, "wb" );
+			if ( !file )
+				return false;
+			bool written = std::fprintf( file, "P6\n%d %d\n255\n", frameWidth, frameHeight ) > 0;
+			for ( int row = 0; row < frameHeight; row++ )
+				written = std::fwrite( fileRow( frame, row ), 1, rowBytes(), file ) == size_t( rowBytes() ) && written;
+			return std::fclose( file ) == 0 && written;
+		}
+
+
+		// stream: "MBRL", version, width, height as uint32,
+		// then per frame: frame index, payload size, payload of ( run length 1..255, r, g, b ) records
+		class RLEStream
+		{
+		public:
+			bool open();
+			bool write( Frame const& frame );
+			void close();
+
+		private:
+			FILE* file = nullptr;
+			std::vector< unsigned char > payload;
+		};
+
+
+		bool RLEStream::open()
+		{
+			std::string fileName = prefix + ".rle";
+			file = std::fopen( fileName.c_str(), "wb" );
+			if ( !file )
+				return false;
+
+			// worst case is one record per pixel
+			payload.resize( size_t( frameWidth ) * frameHeight * ( bytesPerPixel + 1 ) );
+
+			const uint32_t header[4] = { 0x4c52424d, 1, uint32_t( frameWidth ), uint32_t( frameHeight ) };
+			if ( std::fwrite( header, sizeof( header ), 1, file ) != 1 )
+			{
+				close();
+				return false;
+			}
+			return true;
+		}
+
+
+		bool RLEStream::write( Frame const& frame )
+		{
+			unsigned char* out = payload.data();
+			unsigned char* run = nullptr;
+
+			for ( int row = 0; row < frameHeight; row++ )
+			{
+				const unsigned char* pixel = fileRow( frame, row );
+				for ( int x = 0; x < frameWidth; x++, pixel += bytesPerPixel )
+				{
+					if ( run && run[0] < 255 && run[1] == pixel[0] && run[2] == pixel[1] && run[3] == pixel[2] )
+					{
+						run[0]++;
+						continue;
+					}
+					run = out;
+					run[0] = 1;
+					run[1] = pixel[0];
+					run[2] = pixel[1];
+					run[3] = pixel[2];
+					out += bytesPerPixel + 1;
+				}
+			}
+
+			const uint32_t frameHeader[2] = { frame.index, uint32_t( out - payload.data() ) };
+			return std::fwrite( frameHeader, sizeof( frameHeader ), 1, file ) == 1
+				&& std::fwrite( payload.data(), 1, frameHeader[1], file ) == frameHeader[1];
+		}
+
+
+		void RLEStream::close()
+		{
+			if ( file )
+				std::fclose( file );
+			file = nullptr;
+		}
+
+
+		// opened by start on the calling thread, written and closed by the writer thread
+		RLEStream stream;
+
+
+		void writerLoop()
+		{
+			while ( true )
+			{
+				const uint32_t consumed = consumedFrames.load( std::memory_order_relaxed );
+				if ( consumed == producedFrames.load( std::memory_order_acquire ) )
+				{
+					std::unique_lock< std::mutex > lock( writerMutex );
+					if ( writerQuit )
+						break;
+					writerWakeUp.wait( lock, [consumed]{ return writerQuit || consumed != producedFrames.load( std::memory_order_acquire ); } );
+					continue;
+				}
+
+				Frame const& frame = ring[consumed % ringSize];
+				const bool written = format == Format::ppmSequence ? writePPM( frame ) : stream.write( frame );
+				if ( !written )
+					failed++;
+				consumedFrames.store( consumed + 1, std::memory_order_release );
+			}
+
+			stream.close();
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Capture
+{
+	bool start( const char* filePrefix, Format fileFormat )
+	{
+		if ( active || frameWidth <= 0 || frameHeight <= 0 )
+			return false;
+
+		prefix = filePrefix;
+		format = fileFormat;
+		if ( format == Format::rleStream && !stream.open() )
+		{
+			std::printf( "capture: can't open %s.rle\n", prefix.c_str() );
+			return false;
+		}
+
+		for ( Frame& frame : ring )
+			frame.pixels.resize( size_t( frameWidth ) * frameHeight * bytesPerPixel );
+
+		producedFrames.store( 0 );
+		consumedFrames.store( 0 );
+		dropped.store( 0 );
+		frameIndex = 0;
+		failed = 0;
+		writerQuit = false;
+		writer = std::thread( writerLoop );
+		active = true;
+		return true;
+	}
+
+
+	void stop()
+	{
+		if ( !active )
+			return;
+
+		{
+			std::lock_guard< std::mutex > lock( writerMutex );
+			writerQuit = true;
+		}
+		writerWakeUp.notify_one();
+		writer.join();
+		active = false;
+
+		std::printf( "capture: %u frames written, %d failed, %d dropped\n", unsigned( consumedFrames.load() ) - unsigned( failed ), failed, dropped.load() );
+	}
+
+
+	bool isActive()
+	{
+		return active;
+	}
+
+
+	int droppedFrames()
+	{
+		return dropped.load();
+	}
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Capture
+{
+	void init( int width, int height )
+	{
+		frameWidth = width;
+		frameHeight = height;
+	}
+
+
+	void deinit()
+	{
+		stop();
+		for ( Frame& frame : ring )
+			frame.pixels = std::vector< unsigned char >();
+	}
+
+
+	void grabFrame()
+	{
+		if ( !active )
+			return;
+
+		const uint32_t index = frameIndex++;
+		const uint32_t produced = producedFrames.load( std::memory_order_relaxed );
+		if ( produced - consumedFrames.load( std::memory_order_acquire ) == ringSize )
+		{
+			dropped.fetch_add( 1 );
+			return;
+		}
+
+		Frame& frame = ring[produced % ringSize];
+		glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+		glReadBuffer( GL_BACK );
+		glReadPixels( 0, 0, frameWidth, frameHeight, GL_RGB, GL_UNSIGNED_BYTE, frame.pixels.data() );
+		frame.index = index;
+		producedFrames.store( produced + 1, std::memory_order_release );
+
+		{
+			std::lock_guard< std::mutex > lock( writerMutex );
+		}
+		writerWakeUp.notify_one();
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Capture
+{
+	enum class Format
+	{
+		// <prefix>_000000.ppm, <prefix>_000001.ppm, ...
+		ppmSequence,
+		// single <prefix>.rle file of run-length encoded frames
+		rleStream
+	};
+
+	// frames are written by a background thread; if it falls behind, frames are dropped rather than the game stalled.
+	// Fails if a capture is running or the stream file can't be created.
+	bool start( const char* prefix, Format format );
+	void stop();
+	bool isActive();
+
+	// number of frames dropped since last start
+	int droppedFrames();
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Capture
+{
+	void init( int width, int height );
+	void deinit();
+
+	// reads back the frame just rendered, must be called before buffers are swapped
+	void grabFrame();
+}
@@ -1,12 +1,17 @@
 
 #define NOMINMAX
 #include <cassert>
+#include <cmath>
 #include <windows.h>
 #include <windowsx.h>
 #include <GL/gl.h>
 
 #include "game.hpp"
 #include "scene.hpp"
+#include "jobs.hpp"
+#include "capture.hpp"
+#include "telemetry.hpp"
+#include "memory.hpp"
 
 
 //-------------------------------------------------------
@@ -20,6 +25,14 @@ namespace
 	constexpr int windowWidth = 1280;
 	constexpr int windowHeight = 720;
 
+	// fraction of the view an arrow key moves, and zoom change per wheel notch
+	constexpr float cameraPanStep = 0.1f;
+	constexpr float cameraZoomStep = 1.1f;
+
+	// cursor position while panning with the middle button
+	int dragX = 0;
+	int dragY = 0;
+
 
 	//-------------------------------------------------------
 	LRESULT CALLBACK windowProcedure( HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam )
@@ -46,6 +59,30 @@ namespace
 					Scene::screenToWorldY( 1.f - float( GET_Y_LPARAM( lParam ) ) / windowHeight ) );
 				break;
 
+			case WM_MBUTTONDOWN:
+				dragX = GET_X_LPARAM( lParam );
+				dragY = GET_Y_LPARAM( lParam );
+				break;
+
+			case WM_MOUSEMOVE:
+				if ( wParam & MK_MBUTTON )
+				{
+					Scene::panCamera( float( dragX - GET_X_LPARAM( lParam ) ) / windowWidth, float( GET_Y_LPARAM( lParam ) - dragY ) / windowHeight );
+					dragX = GET_X_LPARAM( lParam );
+					dragY = GET_Y_LPARAM( lParam );
+				}
+				break;
+
+			case WM_MOUSEWHEEL:
+			{
+				// wheel messages carry screen coordinates
+				POINT cursor = { GET_X_LPARAM( lParam ), GET_Y_LPARAM( lParam ) };
+				ScreenToClient( hwnd, &cursor );
+				Scene::zoomCamera( std::pow( cameraZoomStep, float( GET_WHEEL_DELTA_WPARAM( wParam ) ) / WHEEL_DELTA ),
+								   float( cursor.x ) / windowWidth, 1.f - float( cursor.y ) / windowHeight );
+				break;
+			}
+
 			case WM_KEYDOWN:
 				if ( wParam == VK_ESCAPE )
 					DestroyWindow( windowHandle );
@@ -54,6 +91,19 @@ namespace
 					Game::deinit();
 					Game::init();
 				}
+				if ( wParam == VK_F9 || wParam == VK_F10 )
+				{
+					if ( Capture::isActive() )
+						Capture::stop();
+					else
+						Capture::start( "capture", wParam == VK_F9 ? Capture::Format::ppmSequence : Capture::Format::rleStream );
+				}
+				if ( wParam == VK_LEFT || wParam == VK_RIGHT )
+					Scene::panCamera( wParam == VK_LEFT ? -cameraPanStep : cameraPanStep, 0.f );
+				if ( wParam == VK_UP || wParam == VK_DOWN )
+					Scene::panCamera( 0.f, wParam == VK_DOWN ? -cameraPanStep : cameraPanStep );
+				if ( wParam == VK_HOME )
+					Scene::setCamera( 0.f, 0.f, 1.f );
 				break;
 		}
 		return DefWindowProc( hwnd, message, wParam, lParam );
@@ -173,6 +223,7 @@ namespace
 	void draw()
 	{
 		Scene::draw();
+		Capture::grabFrame();
 		SwapBuffers( windowDC );
 
 		assert( glGetError() == 0 );
@@ -190,6 +241,8 @@ namespace
 	constexpr int maxFPS = 200;
 	int targetFPS = maxFPS;
 
+	int workerThreads = -1;
+
 	LARGE_INTEGER clockFrequency;
 	LARGE_INTEGER clockLastTick;
 
@@ -221,6 +274,7 @@ namespace
 		}
 
 		Game::update( dt );
+		Telemetry::publish( dt, 1.0 / targetFPS );
 	}
 }
 
@@ -237,19 +291,39 @@ namespace Engine
 	}
 
 
+	void setWorkerThreads( int count )
+	{
+		workerThreads = count > Jobs::maxWorkers ? Jobs::maxWorkers : count < 0 ? -1 : count;
+	}
+
+
 	void run()
 	{
+		Memory::init();
 		initWindow();
 		initOGL();
+		Scene::init();
+		Capture::init( windowWidth, windowHeight );
 		initClock();
+		Telemetry::init();
+		Jobs::init( workerThreads );
 		Game::init();
 		while ( processWindowMessages() )
 		{
+			Memory::beginFrame();
+			Memory::setPhase( Memory::Phase::update );
 			update();
+			Memory::setPhase( Memory::Phase::draw );
 			draw();
+			Memory::endFrame();
 		}
 		Game::deinit();
+		Jobs::deinit();
+		Telemetry::deinit();
+		Capture::deinit();
+		Scene::deinit();
 		deinitOGL();
 		deinitWindow();
+		Memory::deinit();
 	}
 }
@@ -5,6 +5,8 @@
 namespace Engine
 {
 	void setTargetFPS( int fps );
+	// must be called before run; by default, or with a negative count, every hardware thread gets a worker
+	void setWorkerThreads( int count );
 	void run();
 }
 
@@ -0,0 +1,359 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "jobs.hpp"
+
+
+//-------------------------------------------------------
+//	job storage
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	namespace
+	{
+		constexpr int maxDependents = 8;
+		constexpr int jobsPerThread = 4096;
+		constexpr int queueCapacity = jobsPerThread;
+	}
+
+
+	class Job
+	{
+	public:
+		JobFunction function = nullptr;
+		void* context = nullptr;
+		int begin = 0;
+		int end = 0;
+		int grainSize = 0;
+		Job* parent = nullptr;
+
+		// this job and its chunks still running
+		std::atomic< int > unfinished{ 0 };
+		// unfinished dependencies plus one held until submit
+		std::atomic< int > pending{ 0 };
+
+		std::array< Job*, maxDependents > dependents = {};
+		int numDependents = 0;
+	};
+
+
+	namespace
+	{
+		// LIFO for the owner, FIFO for thieves
+		class WorkQueue
+		{
+		public:
+			void push( Job* job );
+			Job* pop();
+			Job* steal();
+
+		private:
+			std::mutex mutex;
+			std::array< Job*, queueCapacity > jobs = {};
+			int head = 0;
+			int tail = 0;
+		};
+
+
+		void WorkQueue::push( Job* job )
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			assert( tail - head < queueCapacity );
+			jobs[tail % queueCapacity] = job;
+			tail++;
+		}
+
+
+		Job* WorkQueue::pop()
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			if ( head == tail )
+				return nullptr;
+			tail--;
+			Job* job = jobs[tail % queueCapacity];
+			if ( head == tail )
+				head = tail = 0;
+			return job;
+		}
+
+
+		Job* WorkQueue::steal()
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			if ( head == tail )
+				return nullptr;
+			Job* job = jobs[head % queueCapacity];
+			head++;
+			if ( head == tail )
+				head = tail = 0;
+			return job;
+		}
+
+
+		class Worker
+		{
+		public:
+			WorkQueue queue;
+			std::unique_ptr< Job[] > jobs{ new Job[jobsPerThread] };
+			int nextJob = 0;
+		};
+
+
+		// worker 0 is the thread that called init
+		std::vector< std::unique_ptr< Worker > > workers;
+		std::vector< std::thread > threads;
+
+		// queues and job rings have a single owner, threads Jobs didn't set up have none
+		thread_local int workerIndex = -1;
+
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+		std::atomic< int > queuedJobs{ 0 };
+		bool quit = false;
+	}
+}
+
+
+//-------------------------------------------------------
+//	scheduling
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	namespace
+	{
+		// checked in release builds too, carrying on would corrupt jobs owned by another thread
+		void fail( const char* message )
+		{
+			std::fprintf( stderr, "Jobs: %s\n", message );
+			std::abort();
+		}
+
+
+		Job* allocateJob()
+		{
+			if ( workerIndex < 0 )
+				fail( "jobs created on a thread that isn't a job thread" );
+			Worker& worker = *workers[workerIndex];
+			Job* job = &worker.jobs[worker.nextJob];
+			worker.nextJob = ( worker.nextJob + 1 ) % jobsPerThread;
+			if ( job->unfinished.load() != 0 )
+				fail( "too many jobs in flight" );
+
+			job->function = nullptr;
+			job->context = nullptr;
+			job->begin = 0;
+			job->end = 0;
+			job->grainSize = 0;
+			job->parent = nullptr;
+			job->unfinished.store( 1 );
+			job->pending.store( 1 );
+			job->numDependents = 0;
+			return job;
+		}
+
+
+		void push( Job* job )
+		{
+			workers[workerIndex]->queue.push( job );
+			queuedJobs.fetch_add( 1 );
+			{
+				std::lock_guard< std::mutex > lock( sleepMutex );
+			}
+			wakeUp.notify_one();
+		}
+
+
+		Job* takeJob()
+		{
+			const int numQueues = int( workers.size() );
+
+			Job* job = workers[workerIndex]->queue.pop();
+			for ( int i = 1; !job && i < numQueues; i++ )
+				job = workers[( workerIndex + i ) % numQueues]->queue.steal();
+
+			if ( job )
+				queuedJobs.fetch_sub( 1 );
+			return job;
+		}
+
+
+		void finish( Job* job )
+		{
+			// once unfinished reaches 0 a waiting thread may return and the job be reused, so nothing is read from it after
+			Job* const parent = job->parent;
+			const int numDependents = job->numDependents;
+			const std::array< Job*, maxDependents > dependents = job->dependents;
+			if ( job->unfinished.fetch_sub( 1 ) != 1 )
+				return;
+
+			for ( int i = 0; i < numDependents; i++ )
+			{
+				if ( dependents[i]->pending.fetch_sub( 1 ) == 1 )
+					push( dependents[i] );
+			}
+
+			if ( parent )
+				finish( parent );
+		}
+
+
+		void execute( Job* job )
+		{
+			if ( job->grainSize > 0 && job->end - job->begin > job->grainSize )
+			{
+				for ( int begin = job->begin; begin < job->end; begin += job->grainSize )
+				{
+					Job* chunk = allocateJob();
+					chunk->function = job->function;
+					chunk->context = job->context;
+					chunk->begin = begin;
+					chunk->end = std::min( begin + job->grainSize, job->end );
+					chunk->parent = job;
+					chunk->pending.store( 0 );
+					job->unfinished.fetch_add( 1 );
+					push( chunk );
+				}
+			}
+			else
+			{
+				job->function( job->context, job->begin, job->end );
+			}
+			finish( job );
+		}
+
+
+		void workerLoop( int index )
+		{
+			workerIndex = index;
+			while ( true )
+			{
+				if ( Job* job = takeJob() )
+				{
+					execute( job );
+					continue;
+				}
+
+				std::unique_lock< std::mutex > lock( sleepMutex );
+				wakeUp.wait( lock, []{ return quit || queuedJobs.load() > 0; } );
+				if ( quit )
+					break;
+			}
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	public jobs interface
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	Job* createJob( JobFunction function, void* context )
+	{
+		return createParallelJob( function, context, 0, 1, 0 );
+	}
+
+
+	Job* createParallelJob( JobFunction function, void* context, int begin, int end, int grainSize )
+	{
+		assert( function );
+		Job* job = allocateJob();
+		job->function = function;
+		job->context = context;
+		job->begin = begin;
+		job->end = end;
+		job->grainSize = grainSize;
+		return job;
+	}
+
+
+	void addDependency( Job* job, Job* dependency )
+	{
+		assert( job->pending.load() > 0 && dependency->pending.load() > 0 );
+		assert( dependency->numDependents < maxDependents );
+		dependency->dependents[dependency->numDependents++] = job;
+		job->pending.fetch_add( 1 );
+	}
+
+
+	void submit( Job* job )
+	{
+		if ( job->pending.fetch_sub( 1 ) == 1 )
+			push( job );
+	}
+
+
+	void wait( Job* job )
+	{
+		while ( job->unfinished.load() > 0 )
+		{
+			if ( Job* next = takeJob() )
+				execute( next );
+			else
+				std::this_thread::yield();
+		}
+	}
+
+
+	int workerCount()
+	{
+		return int( threads.size() );
+	}
+
+
+	bool isJobThread()
+	{
+		return workerIndex >= 0;
+	}
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	void init( int numWorkers )
+	{
+		assert( workers.empty() );
+
+		if ( numWorkers < 0 )
+			numWorkers = int( std::thread::hardware_concurrency() ) - 1;
+		numWorkers = std::max( std::min( numWorkers, maxWorkers ), 0 );
+
+		quit = false;
+		workerIndex = 0;
+		for ( int i = 0; i <= numWorkers; i++ )
+			workers.emplace_back( new Worker );
+		for ( int i = 1; i <= numWorkers; i++ )
+			threads.emplace_back( workerLoop, i );
+	}
+
+
+	void deinit()
+	{
+		{
+			std::lock_guard< std::mutex > lock( sleepMutex );
+			quit = true;
+		}
+		wakeUp.notify_all();
+		for ( std::thread& thread : threads )
+			thread.join();
+		threads.clear();
+		workers.clear();
+		workerIndex = -1;
+	}
+}
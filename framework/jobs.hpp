@@ -0,0 +1,129 @@
+#pragma once
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	class Job;
+
+	// worker threads besides the main one
+	constexpr int maxWorkers = 31;
+
+	using JobFunction = void (*)( void* context, int begin, int end );
+
+	// Jobs are taken from a fixed ring per thread, so a job handle stays valid
+	// only until a few thousand more jobs are created on the same thread;
+	// reusing a job that is still running aborts.
+	// Only the thread that called init and worker threads may create jobs, other threads abort.
+
+	// runs function( context, 0, 1 ) once
+	Job* createJob( JobFunction function, void* context );
+
+	// splits [begin, end) into chunks of grainSize elements, runs function( context, chunkBegin, chunkEnd ) for each.
+	// Chunk boundaries depend on grainSize only, never on the number of workers, so a job
+	// that writes only to its own elements gives the same result with any thread count.
+	Job* createParallelJob( JobFunction function, void* context, int begin, int end, int grainSize );
+
+	// job won't start before dependency is finished; neither of them may be submitted yet
+	void addDependency( Job* job, Job* dependency );
+
+	void submit( Job* job );
+
+	// calling thread executes pending jobs while waiting
+	void wait( Job* job );
+
+	int workerCount();
+
+	// true on the thread that called init and on worker threads
+	bool isJobThread();
+
+
+	// convenience wrappers taking callables, callable must outlive the job
+	template< class Function >
+	Job* createJob( Function const& function );
+
+	template< class Function >
+	Job* createParallelJob( int begin, int end, int grainSize, Function const& function );
+
+	template< class Function >
+	void parallelFor( int begin, int end, int grainSize, Function const& function );
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	// negative count means one worker per hardware thread except the main one
+	void init( int numWorkers );
+	void deinit();
+}
+
+
+//-------------------------------------------------------
+//	template implementation
+//-------------------------------------------------------
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		template< class Function >
+		void runOnce( void* context, int, int )
+		{
+			( *static_cast< Function const* >( context ) )();
+		}
+
+
+		template< class Function >
+		void runForEach( void* context, int begin, int end )
+		{
+			Function const& function = *static_cast< Function const* >( context );
+			for ( int i = begin; i < end; i++ )
+				function( i );
+		}
+
+
+		template< class Function >
+		void* toContext( Function const& function )
+		{
+			return const_cast< void* >( static_cast< void const* >( &function ) );
+		}
+	}
+
+
+	template< class Function >
+	Job* createJob( Function const& function )
+	{
+		return createJob( &Detail::runOnce< Function >, Detail::toContext( function ) );
+	}
+
+
+	template< class Function >
+	Job* createParallelJob( int begin, int end, int grainSize, Function const& function )
+	{
+		return createParallelJob( &Detail::runForEach< Function >, Detail::toContext( function ), begin, end, grainSize );
+	}
+
+
+	template< class Function >
+	void parallelFor( int begin, int end, int grainSize, Function const& function )
+	{
+		// a single chunk is run right here, exactly as a worker would run it; so is the whole range
+		// on threads that can't create jobs, with the same result
+		if ( end - begin <= grainSize || !isJobThread() )
+		{
+			Detail::runForEach< Function >( Detail::toContext( function ), begin, end );
+			return;
+		}
+
+		Job* job = createParallelJob( begin, end, grainSize, function );
+		submit( job );
+		wait( job );
+	}
+}
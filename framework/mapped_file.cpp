@@ -0,0 +1,74 @@
+#define NOMINMAX
+#include <windows.h>
+
+#include <cstdint>
+
+#include "mapped_file.hpp"
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+bool MappedFile::open( const char* path )
+{
+	close();
+
+	HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart <= 0 || uint64_t( fileSize.QuadPart ) > SIZE_MAX )
+	{
+		close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( mappingHandle )
+		view = static_cast< const unsigned char* >( MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( !view )
+	{
+		close();
+		return false;
+	}
+	viewSize = size_t( fileSize.QuadPart );
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if ( view )
+		UnmapViewOfFile( view );
+	if ( mappingHandle )
+		CloseHandle( mappingHandle );
+	if ( fileHandle )
+		CloseHandle( fileHandle );
+	view = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	viewSize = 0;
+}
+
+
+bool MappedFile::isOpen() const
+{
+	return view != nullptr;
+}
+
+
+const unsigned char* MappedFile::data() const
+{
+	return view;
+}
+
+
+size_t MappedFile::size() const
+{
+	return viewSize;
+}
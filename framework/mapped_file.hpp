@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+// Read-only view of a whole file. Pages come from the system file cache on first touch,
+// so opening costs no reading and processes mapping the same file share one copy.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile( MappedFile const& ) = delete;
+	~MappedFile();
+
+	// fails on missing and empty files
+	bool open( const char* path );
+	void close();
+
+	bool isOpen() const;
+	const unsigned char* data() const;
+	size_t size() const;
+
+private:
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+	const unsigned char* view = nullptr;
+	size_t viewSize = 0;
+};
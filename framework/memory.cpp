@@ -0,0 +1,344 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <algorithm>
+
+#include "memory.hpp"
+
+
+#ifndef MINIBILL_TRACK_ALLOCATIONS
+#ifdef _DEBUG
+#define MINIBILL_TRACK_ALLOCATIONS 1
+#else
+#define MINIBILL_TRACK_ALLOCATIONS 0
+#endif
+#endif
+
+
+//-------------------------------------------------------
+//	allocation tracking
+//-------------------------------------------------------
+
+namespace Memory
+{
+	namespace
+	{
+		constexpr int numPhases = int( Phase::count );
+		// first frames fill pools and grow the frame arena
+		constexpr int warmUpFrames = 60;
+
+		// only the thread that sets phases, the engine's main thread, is counted; workers and
+		// writer threads run at their own pace and aren't part of the frame
+		thread_local int currentPhase = -1;
+		int frameAllocations[numPhases] = {};
+		int lastFrameAllocations[numPhases] = {};
+
+		bool zeroAllocationCheck = MINIBILL_TRACK_ALLOCATIONS != 0;
+		int frameNumber = 0;
+
+
+		void* trackedAllocate( size_t size )
+		{
+#if MINIBILL_TRACK_ALLOCATIONS
+			if ( currentPhase >= 0 )
+				frameAllocations[currentPhase]++;
+#endif
+			return std::malloc( size ? size : 1 );
+		}
+	}
+}
+
+
+#if MINIBILL_TRACK_ALLOCATIONS
+
+void* operator new( size_t size )
+{
+	if ( void* memory = Memory::trackedAllocate( size ) )
+		return memory;
+	throw std::bad_alloc();
+}
+
+
+void* operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+
+void* operator new( size_t size, std::nothrow_t const& ) noexcept
+{
+	return Memory::trackedAllocate( size );
+}
+
+
+void* operator new[]( size_t size, std::nothrow_t const& ) noexcept
+{
+	return Memory::trackedAllocate( size );
+}
+
+
+void operator delete( void* memory ) noexcept
+{
+	std::free( memory );
+}
+
+
+void operator delete[]( void* memory ) noexcept
+{
+	std::free( memory );
+}
+
+
+void operator delete( void* memory, size_t ) noexcept
+{
+	std::free( memory );
+}
+
+
+void operator delete[]( void* memory, size_t ) noexcept
+{
+	std::free( memory );
+}
+
+
+void operator delete( void* memory, std::nothrow_t const& ) noexcept
+{
+	std::free( memory );
+}
+
+
+void operator delete[]( void* memory, std::nothrow_t const& ) noexcept
+{
+	std::free( memory );
+}
+
+#endif
+
+
+//-------------------------------------------------------
+//	frame arena
+//-------------------------------------------------------
+
+namespace Memory
+{
+	namespace
+	{
+		namespace FrameArena
+		{
+			constexpr size_t initialCapacity = 1 << 20;
+
+			unsigned char* buffer = nullptr;
+			size_t capacity = 0;
+			size_t used = 0;
+
+			// memory taken from the heap after the buffer ran out, given back on next reset
+			struct Overflow
+			{
+				Overflow* next;
+			};
+			Overflow* overflows = nullptr;
+			size_t overflowBytes = 0;
+
+
+			void reset()
+			{
+				// grow once to the high water mark, so the same load fits next time; overflow bytes
+				// include alignment slack, so the new capacity errs on the large side
+				if ( overflows )
+				{
+					while ( overflows )
+					{
+						Overflow* next = overflows->next;
+						std::free( overflows );
+						overflows = next;
+					}
+					std::free( buffer );
+					capacity += overflowBytes;
+					buffer = static_cast< unsigned char* >( std::malloc( capacity ) );
+					overflowBytes = 0;
+				}
+				used = 0;
+			}
+
+
+			void* allocate( size_t size, size_t alignment )
+			{
+				assert( buffer && alignment && ( alignment & ( alignment - 1 ) ) == 0 );
+
+				const uintptr_t start = ( uintptr_t( buffer ) + used + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+				const size_t end = size_t( start - uintptr_t( buffer ) ) + size;
+				if ( end <= capacity )
+				{
+					used = end;
+					return reinterpret_cast< void* >( start );
+				}
+
+				const size_t headerSize = std::max( sizeof( Overflow ), alignment );
+				unsigned char* block = static_cast< unsigned char* >( trackedAllocate( headerSize + size + alignment ) );
+				Overflow* overflow = reinterpret_cast< Overflow* >( block );
+				overflow->next = overflows;
+				overflows = overflow;
+				overflowBytes += size + alignment;
+
+				const uintptr_t overflowStart = ( uintptr_t( block ) + headerSize + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+				return reinterpret_cast< void* >( overflowStart );
+			}
+		}
+	}
+
+
+	void* frameAllocate( size_t size, size_t alignment )
+	{
+		return FrameArena::allocate( size, alignment );
+	}
+}
+
+
+//-------------------------------------------------------
+//	pool
+//-------------------------------------------------------
+
+namespace Memory
+{
+	namespace
+	{
+		constexpr size_t blockAlignment = alignof( std::max_align_t );
+
+
+		size_t alignUp( size_t size )
+		{
+			return ( size + blockAlignment - 1 ) & ~( blockAlignment - 1 );
+		}
+	}
+
+
+	Pool::Pool( size_t blockSize, int blocksPerChunk ) :
+		blockSize( alignUp( std::max( blockSize, sizeof( FreeBlock ) ) ) ),
+		blocksPerChunk( blocksPerChunk )
+	{
+		assert( blocksPerChunk > 0 );
+	}
+
+
+	Pool::~Pool()
+	{
+		while ( chunks )
+		{
+			void* next = *static_cast< void** >( chunks );
+			std::free( chunks );
+			chunks = next;
+		}
+	}
+
+
+	// every chunk starts with a pointer to the previous one
+	void Pool::addChunk()
+	{
+		const size_t headerSize = alignUp( sizeof( void* ) );
+		unsigned char* chunk = static_cast< unsigned char* >( trackedAllocate( headerSize + blockSize * blocksPerChunk ) );
+		if ( !chunk )
+			throw std::bad_alloc();
+
+		*reinterpret_cast< void** >( chunk ) = chunks;
+		chunks = chunk;
+
+		for ( int i = blocksPerChunk - 1; i >= 0; i-- )
+		{
+			FreeBlock* block = reinterpret_cast< FreeBlock* >( chunk + headerSize + blockSize * i );
+			block->next = freeList;
+			freeList = block;
+		}
+	}
+
+
+	void* Pool::allocate()
+	{
+		if ( !freeList )
+			addChunk();
+		FreeBlock* block = freeList;
+		freeList = block->next;
+		return block;
+	}
+
+
+	void Pool::deallocate( void* block )
+	{
+		if ( !block )
+			return;
+		FreeBlock* freeBlock = static_cast< FreeBlock* >( block );
+		freeBlock->next = freeList;
+		freeList = freeBlock;
+	}
+}
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Memory
+{
+	int allocationCount( Phase phase )
+	{
+		return lastFrameAllocations[int( phase )];
+	}
+
+
+	void setZeroAllocationCheck( bool enabled )
+	{
+		zeroAllocationCheck = enabled;
+	}
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Memory
+{
+	void init()
+	{
+		assert( !FrameArena::buffer );
+		FrameArena::capacity = FrameArena::initialCapacity;
+		FrameArena::buffer = static_cast< unsigned char* >( std::malloc( FrameArena::capacity ) );
+		FrameArena::used = 0;
+		frameNumber = 0;
+	}
+
+
+	void deinit()
+	{
+		FrameArena::reset();
+		std::free( FrameArena::buffer );
+		FrameArena::buffer = nullptr;
+		FrameArena::capacity = 0;
+	}
+
+
+	void beginFrame()
+	{
+		FrameArena::reset();
+		for ( int& count : frameAllocations )
+			count = 0;
+	}
+
+
+	void setPhase( Phase phase )
+	{
+		currentPhase = int( phase );
+	}
+
+
+	void endFrame()
+	{
+		setPhase( Phase::other );
+		for ( int i = 0; i < numPhases; i++ )
+			lastFrameAllocations[i] = frameAllocations[i];
+
+		frameNumber++;
+		assert( !zeroAllocationCheck || frameNumber <= warmUpFrames ||
+				( lastFrameAllocations[int( Phase::update )] == 0 && lastFrameAllocations[int( Phase::draw )] == 0 && "steady state frame allocated" ) );
+	}
+}
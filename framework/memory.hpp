@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Memory
+{
+	// Per-frame linear arena for scratch data, released all at once when the next frame begins.
+	// Allocate from the main thread only; jobs may fill memory allocated before they started.
+	void* frameAllocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+
+	template< class T >
+	T* frameArray( int count );
+
+
+	// Fixed size blocks for long-lived objects. Grows by chunks and never returns memory
+	// before destruction, so steady state allocation and release never reach the heap.
+	class Pool
+	{
+	public:
+		Pool( size_t blockSize, int blocksPerChunk );
+		Pool( Pool const& ) = delete;
+		~Pool();
+
+		void* allocate();
+		void deallocate( void* block );
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		void addChunk();
+
+		size_t const blockSize;
+		int const blocksPerChunk;
+		FreeBlock* freeList = nullptr;
+		void* chunks = nullptr;
+	};
+
+
+	enum class Phase
+	{
+		other,
+		update,
+		draw,
+		count
+	};
+
+	// heap allocations the main thread made during the last finished frame, counted only in builds with allocation tracking
+	int allocationCount( Phase phase );
+
+	// when enabled, a steady state frame that allocates in update or draw phase triggers an assert
+	void setZeroAllocationCheck( bool enabled );
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Memory
+{
+	void init();
+	void deinit();
+
+	void beginFrame();
+	// also marks the calling thread as the one whose allocations are counted
+	void setPhase( Phase phase );
+	void endFrame();
+}
+
+
+//-------------------------------------------------------
+//	template implementation
+//-------------------------------------------------------
+
+namespace Memory
+{
+	template< class T >
+	T* frameArray( int count )
+	{
+		static_assert( std::is_trivially_destructible< T >::value, "frame memory is released without destructors" );
+		return static_cast< T* >( frameAllocate( sizeof( T ) * size_t( count ), alignof( T ) ) );
+	}
+}
@@ -9,6 +9,8 @@
 #include <cmath>
 
 #include "scene.hpp"
+#include "jobs.hpp"
+#include "memory.hpp"
 
 
 namespace Scene
@@ -34,27 +36,40 @@ namespace Scene
 		};
 
 
-		void setupGLColor( Color color )
+		struct ColorRGB
+		{
+			float r;
+			float g;
+			float b;
+		};
+
+
+		ColorRGB toRGB( Color color )
 		{
 			switch ( color )
 			{
 				case Color::red:
-					glColor3f( 1.f, 0.f, 0.f );
-					break;
+					return { 1.f, 0.f, 0.f };
 				case Color::green:
-					glColor3f( 0.f, 1.f, 0.f );
-					break;
+					return { 0.f, 1.f, 0.f };
 				case Color::blue:
-					glColor3f( 0.f, 0.f, 1.f );
-					break;
+					return { 0.f, 0.f, 1.f };
 				case Color::black:
-					glColor3f( 0.f, 0.f, 0.f );
-					break;
+					return { 0.f, 0.f, 0.f };
 				case Color::white:
-					glColor3f( 1.f, 1.f, 1.f );
-					break;
+					return { 1.f, 1.f, 1.f };
 			}
+			return { 0.f, 0.f, 0.f };
 		}
+
+
+		// world space triangle list vertex
+		struct Vertex
+		{
+			float x;
+			float y;
+			ColorRGB color;
+		};
 	}
 }
 
@@ -73,7 +88,21 @@ namespace Scene
 		float angle = 0.f;
 
 		virtual ~Mesh();
-		virtual void draw();
+
+		// meshes are drawn as triangle lists built on job threads, so these must not touch GL
+		virtual int numVertices() const = 0;
+		virtual void buildVertices( Vertex* vertices ) const = 0;
+		// every vertex lies within this distance of the position
+		virtual float boundingRadius() const = 0;
+
+		// creation rank, visible meshes are drawn in this order whatever the grid returns them in
+		int drawOrder = 0;
+
+		// spatial grid membership, see Grid
+		int cellX = 0;
+		int cellY = 0;
+		Mesh* cellPrevious = nullptr;
+		Mesh* cellNext = nullptr;
 
 		static std::vector< Mesh* > meshes;
 	};
@@ -85,21 +114,145 @@ namespace Scene
 	Mesh::~Mesh()
 	{
 	}
+}
+
 
+//-------------------------------------------------------
+//	spatial grid support
+//-------------------------------------------------------
 
-	void Mesh::draw()
+namespace Scene
+{
+	namespace
 	{
-		glLoadIdentity();
-		glTranslatef( positionX, positionY, 0.f );
-		glRotatef( angle * 180.f / pi, 0.f, 0.f, 1.f );
+		// Meshes are hashed by the cell holding their position into intrusive lists, so moving a mesh
+		// never allocates. Several cells may share a bucket, lookups check the cell coordinates.
+		namespace Grid
+		{
+			constexpr float cellSize = 2.f;
+			constexpr int numBuckets = 4096;
+
+			Mesh* buckets[numBuckets] = {};
+			// largest bounding radius so far, a mesh can reach that far out of its cell
+			float maxRadius = 0.f;
+
+
+			int cellOf( float position )
+			{
+				return int( std::floor( position / cellSize ) );
+			}
+
+
+			Mesh*& bucket( int x, int y )
+			{
+				const unsigned hash = unsigned( x ) * 73856093u ^ unsigned( y ) * 19349663u;
+				return buckets[hash & ( numBuckets - 1 )];
+			}
+
+
+			void insert( Mesh* mesh )
+			{
+				mesh->cellX = cellOf( mesh->positionX );
+				mesh->cellY = cellOf( mesh->positionY );
+				Mesh*& head = bucket( mesh->cellX, mesh->cellY );
+				mesh->cellPrevious = nullptr;
+				mesh->cellNext = head;
+				if ( head )
+					head->cellPrevious = mesh;
+				head = mesh;
+			}
+
+
+			void remove( Mesh* mesh )
+			{
+				if ( mesh->cellPrevious )
+					mesh->cellPrevious->cellNext = mesh->cellNext;
+				else
+					bucket( mesh->cellX, mesh->cellY ) = mesh->cellNext;
+				if ( mesh->cellNext )
+					mesh->cellNext->cellPrevious = mesh->cellPrevious;
+				mesh->cellPrevious = nullptr;
+				mesh->cellNext = nullptr;
+			}
+
+
+			void update( Mesh* mesh )
+			{
+				if ( cellOf( mesh->positionX ) == mesh->cellX && cellOf( mesh->positionY ) == mesh->cellY )
+					return;
+				remove( mesh );
+				insert( mesh );
+			}
+
+
+			bool overlaps( Mesh const* mesh, float left, float bottom, float right, float top )
+			{
+				const float radius = mesh->boundingRadius();
+				return mesh->positionX + radius >= left && mesh->positionX - radius <= right &&
+					   mesh->positionY + radius >= bottom && mesh->positionY - radius <= top;
+			}
+
+
+			// writes meshes overlapping the rectangle in creation order, returns their count;
+			// visits cells or meshes, whichever are fewer
+			int query( float left, float bottom, float right, float top, Mesh** visible )
+			{
+				const int minX = cellOf( left - maxRadius );
+				const int maxX = cellOf( right + maxRadius );
+				const int minY = cellOf( bottom - maxRadius );
+				const int maxY = cellOf( top + maxRadius );
+				const double numCells = double( maxX - minX + 1 ) * double( maxY - minY + 1 );
+
+				int count = 0;
+				if ( numCells > double( Mesh::meshes.size() ) )
+				{
+					for ( Mesh* mesh : Mesh::meshes )
+						if ( overlaps( mesh, left, bottom, right, top ) )
+							visible[count++] = mesh;
+					return count;
+				}
+
+				for ( int y = minY; y <= maxY; y++ )
+					for ( int x = minX; x <= maxX; x++ )
+						for ( Mesh* mesh = bucket( x, y ); mesh; mesh = mesh->cellNext )
+							if ( mesh->cellX == x && mesh->cellY == y && overlaps( mesh, left, bottom, right, top ) )
+								visible[count++] = mesh;
+
+				std::sort( visible, visible + count, []( Mesh const* a, Mesh const* b ) { return a->drawOrder < b->drawOrder; } );
+				return count;
+			}
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	user interface: mesh lifetime
+//-------------------------------------------------------
+
+namespace Scene
+{
+	namespace
+	{
+		constexpr size_t maxMeshSize = 64;
+		constexpr int meshesPerChunk = 256;
+
+		// meshes are recreated on every restart, the pool keeps that off the heap
+		Memory::Pool meshPool( maxMeshSize, meshesPerChunk );
+
+		int nextDrawOrder = 0;
 	}
 
 
 	template< class MeshClass, class... Args >
 	Mesh* createMesh( Args&&... args )
 	{
-		Mesh* mesh = new MeshClass( std::forward< Args >( args )... );
+		static_assert( sizeof( MeshClass ) <= maxMeshSize, "mesh doesn't fit pool block" );
+		Mesh* mesh = new ( meshPool.allocate() ) MeshClass( std::forward< Args >( args )... );
+		mesh->drawOrder = nextDrawOrder++;
 		Mesh::meshes.push_back( mesh );
+		Grid::maxRadius = std::max( Grid::maxRadius, mesh->boundingRadius() );
+		Grid::insert( mesh );
 		return mesh;
 	}
 
@@ -109,7 +262,9 @@ namespace Scene
 		auto it = std::find( Mesh::meshes.begin(), Mesh::meshes.end(), mesh );
 		assert( it != Mesh::meshes.end() );
 		Mesh::meshes.erase( it );
-		delete mesh;
+		Grid::remove( mesh );
+		mesh->~Mesh();
+		meshPool.deallocate( mesh );
 	}
 
 
@@ -118,6 +273,7 @@ namespace Scene
 		mesh->positionX = x;
 		mesh->positionY = y;
 		mesh->angle = angle;
+		Grid::update( mesh );
 	}
 }
 
@@ -134,9 +290,13 @@ namespace Scene
 		{
 		public:
 			CircleMesh( float radius, Color color );
-			void draw() override;
+			int numVertices() const override;
+			void buildVertices( Vertex* vertices ) const override;
+			float boundingRadius() const override;
 
 		private:
+			static constexpr int numTriangles = 16;
+
 			float const radius;
 			Color const color;
 		};
@@ -149,23 +309,54 @@ namespace Scene
 		}
 
 
-		void CircleMesh::draw()
+		int CircleMesh::numVertices() const
 		{
-			Mesh::draw();
+			return 3 * numTriangles;
+		}
+
 
-			constexpr int numTriangles = 16;
+		void CircleMesh::buildVertices( Vertex* vertices ) const
+		{
+			// unit circle is shared by all circles, rotation and radius are applied per mesh
+			struct UnitCircle
+			{
+				float cos[numTriangles + 1];
+				float sin[numTriangles + 1];
+
+				UnitCircle()
+				{
+					for ( int i = 0; i <= numTriangles; i++ )
+					{
+						cos[i] = std::cos( float( i ) / float( numTriangles ) * 2.f * pi );
+						sin[i] = std::sin( float( i ) / float( numTriangles ) * 2.f * pi );
+					}
+				}
+			};
+			static const UnitCircle unitCircle;
+
+			const float rotationCos = radius * std::cos( angle );
+			const float rotationSin = radius * std::sin( angle );
+			const ColorRGB rgb = toRGB( color );
+
+			auto edgeVertex = [&]( int i ) -> Vertex
+			{
+				return { positionX + rotationCos * unitCircle.cos[i] - rotationSin * unitCircle.sin[i],
+						 positionY + rotationSin * unitCircle.cos[i] + rotationCos * unitCircle.sin[i],
+						 rgb };
+			};
 
-			glBegin( GL_TRIANGLES );
-			setupGLColor( color );
 			for ( int i = 0; i < numTriangles; i++ )
 			{
-				float angle1 = float( i ) / float( numTriangles ) * 2.f * pi;
-				float angle2 = float( i + 1 ) / float( numTriangles ) * 2.f * pi;
-				glVertex2f( radius * std::cos( angle1 ), radius * std::sin( angle1 ) );
-				glVertex2f( 0.f, 0.f );
-				glVertex2f( radius * std::cos( angle2 ), radius * std::sin( angle2 ) );
+				*vertices++ = edgeVertex( i );
+				*vertices++ = { positionX, positionY, rgb };
+				*vertices++ = edgeVertex( i + 1 );
 			}
-			glEnd();
+		}
+
+
+		float CircleMesh::boundingRadius() const
+		{
+			return radius;
 		}
 	}
 
@@ -183,6 +374,57 @@ namespace Scene
 }
 
 
+//-------------------------------------------------------
+// user interface: camera support
+//-------------------------------------------------------
+
+namespace Scene
+{
+	namespace
+	{
+		namespace Camera
+		{
+			constexpr float minZoom = 0.05f;
+			constexpr float maxZoom = 20.f;
+
+			float x = 0.f;
+			float y = 0.f;
+			// 1 shows the default View around the camera position
+			float zoom = 1.f;
+
+
+			float halfWidth()
+			{
+				return 0.5f * View::width / zoom;
+			}
+
+
+			float halfHeight()
+			{
+				return 0.5f * View::height / zoom;
+			}
+
+
+			// world space drawing, the projection keeps View size so screen space elements only reset the modelview
+			void loadMatrix()
+			{
+				glLoadIdentity();
+				glScalef( zoom, zoom, 1.f );
+				glTranslatef( -x, -y, 0.f );
+			}
+		}
+	}
+
+
+	void setCamera( float x, float y, float zoom )
+	{
+		Camera::x = x;
+		Camera::y = y;
+		Camera::zoom = std::max( std::min( zoom, Camera::maxZoom ), Camera::minZoom );
+	}
+}
+
+
 //-------------------------------------------------------
 // user interface: frame support
 //-------------------------------------------------------
@@ -210,16 +452,19 @@ namespace Scene
 					glEnd();
 				};
 
-				constexpr float viewHalfWidth = 0.5f * View::width;
-				constexpr float viewHalfHeight = 0.5f * View::height;
+				const float viewLeft = Camera::x - Camera::halfWidth();
+				const float viewRight = Camera::x + Camera::halfWidth();
+				const float viewBottom = Camera::y - Camera::halfHeight();
+				const float viewTop = Camera::y + Camera::halfHeight();
 				const float backHalfWidth = 0.5f * Background::width;
 				const float backHalfHeight = 0.5f * Background::height;
 
-				glLoadIdentity();
-				drawRectangle( -viewHalfWidth, viewHalfHeight, -backHalfWidth, -viewHalfHeight );
-				drawRectangle( backHalfWidth, viewHalfHeight, viewHalfWidth, -viewHalfHeight );
-				drawRectangle( -backHalfWidth, viewHalfHeight,backHalfWidth, backHalfHeight );
-				drawRectangle( -backHalfWidth, -backHalfHeight,backHalfWidth, -viewHalfHeight );
+				// a table side out of view gives a rectangle out of view too, so nothing needs clamping
+				Camera::loadMatrix();
+				drawRectangle( viewLeft, viewTop, -backHalfWidth, viewBottom );
+				drawRectangle( backHalfWidth, viewTop, viewRight, viewBottom );
+				drawRectangle( -backHalfWidth, viewTop, backHalfWidth, backHalfHeight );
+				drawRectangle( -backHalfWidth, -backHalfHeight, backHalfWidth, viewBottom );
 			}
 		}
 	}
@@ -273,12 +518,86 @@ namespace Scene
 }
 
 
+//-------------------------------------------------------
+//	draw list support
+//-------------------------------------------------------
+
+namespace Scene
+{
+	namespace
+	{
+		namespace DrawList
+		{
+			constexpr int meshesPerJob = 64;
+
+			int numVertices = 0;
+			Vertex* vertices = nullptr;
+
+
+			// only meshes overlapping the camera view are built and submitted
+			void build()
+			{
+				Mesh** visible = Memory::frameArray< Mesh* >( int( Mesh::meshes.size() ) );
+				const int numMeshes = Grid::query( Camera::x - Camera::halfWidth(), Camera::y - Camera::halfHeight(),
+												   Camera::x + Camera::halfWidth(), Camera::y + Camera::halfHeight(), visible );
+
+				int* offsets = Memory::frameArray< int >( numMeshes + 1 );
+				offsets[0] = 0;
+				for ( int i = 0; i < numMeshes; i++ )
+					offsets[i + 1] = offsets[i] + visible[i]->numVertices();
+				numVertices = offsets[numMeshes];
+				vertices = Memory::frameArray< Vertex >( numVertices );
+
+				// every mesh writes its own slice, so the list doesn't depend on the number of workers
+				Jobs::parallelFor( 0, numMeshes, meshesPerJob, [visible, offsets]( int i )
+				{
+					visible[i]->buildVertices( &vertices[offsets[i]] );
+				} );
+			}
+
+
+			void draw()
+			{
+				Camera::loadMatrix();
+				glBegin( GL_TRIANGLES );
+				for ( int i = 0; i < numVertices; i++ )
+				{
+					glColor3f( vertices[i].color.r, vertices[i].color.g, vertices[i].color.b );
+					glVertex2f( vertices[i].x, vertices[i].y );
+				}
+				glEnd();
+			}
+		}
+	}
+}
+
+
 //-------------------------------------------------------
 //	engine only interface
 //-------------------------------------------------------
 
 namespace Scene
 {
+	namespace
+	{
+		constexpr int expectedMeshes = 256;
+	}
+
+
+	void init()
+	{
+		Mesh::meshes.reserve( expectedMeshes );
+	}
+
+
+	void deinit()
+	{
+		while ( !Mesh::meshes.empty() )
+			destroyMesh( Mesh::meshes.back() );
+		Mesh::meshes = std::vector< Mesh* >();
+	}
+
+
 	void draw()
 	{
 		glMatrixMode( GL_PROJECTION );
@@ -290,8 +609,8 @@ namespace Scene
 		glClear( GL_COLOR_BUFFER_BIT );
 		glMatrixMode( GL_MODELVIEW );
 
-		for ( Mesh *mesh : Mesh::meshes )
-			mesh->draw();
+		DrawList::build();
+		DrawList::draw();
 
 		Background::draw();
 		ProgressBar::draw();
@@ -300,12 +619,30 @@ namespace Scene
 
 	float screenToWorldX( float x )
 	{
-		return 0.5f * View::width * ( 2.f * x - 1.f );
+		return Camera::x + Camera::halfWidth() * ( 2.f * x - 1.f );
 	}
 
 
 	float screenToWorldY( float y )
 	{
-		return 0.5f * View::height * ( 2.f * y - 1.f );
+		return Camera::y + Camera::halfHeight() * ( 2.f * y - 1.f );
+	}
+
+
+	void panCamera( float screenX, float screenY )
+	{
+		Camera::x += 2.f * Camera::halfWidth() * screenX;
+		Camera::y += 2.f * Camera::halfHeight() * screenY;
+	}
+
+
+	void zoomCamera( float factor, float screenX, float screenY )
+	{
+		// the world point under the cursor stays under it
+		const float worldX = screenToWorldX( screenX );
+		const float worldY = screenToWorldY( screenY );
+		setCamera( Camera::x, Camera::y, Camera::zoom * factor );
+		Camera::x += worldX - screenToWorldX( screenX );
+		Camera::y += worldY - screenToWorldY( screenY );
 	}
 }
@@ -18,6 +18,9 @@ namespace Scene
 	void setupBackground( float width, float height );
 
 	void updateProgressBar( float progress );
+
+	// centres the view on (x, y); zoom 1 shows 16x9 world units, larger zooms in
+	void setCamera( float x, float y, float zoom );
 }
 
 
@@ -27,7 +30,16 @@ namespace Scene
 
 namespace Scene
 {
+	void init();
+	void deinit();
+
 	void draw();
+	// screen coordinates go from 0 to 1, bottom left to top right
 	float screenToWorldX( float x );
-	float screenToWorldY( float x );
+	float screenToWorldY( float y );
+
+	// moves the view by a fraction of its size
+	void panCamera( float screenX, float screenY );
+	// scales the zoom, keeping the world point under the screen point in place
+	void zoomCamera( float factor, float screenX, float screenY );
 }
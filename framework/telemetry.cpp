@@ -0,0 +1,170 @@
+#define NOMINMAX
+#include <windows.h>
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "telemetry.hpp"
+
+
+//-------------------------------------------------------
+//	shared segment and slot ownership
+//-------------------------------------------------------
+
+namespace Telemetry
+{
+	namespace
+	{
+		HANDLE mappingHandle = nullptr;
+		Segment* segment = nullptr;
+		Slot* slot = nullptr;
+
+		uint64_t frame = 0;
+		uint64_t simulationSteps = 0;
+		uint32_t activeBalls = 0;
+
+		double jitterWindowTime = 0.0;
+		uint32_t jitterWindowMax = 0;
+		uint32_t lastWindowMaxJitter = 0;
+
+
+		bool isProcessAlive( uint32_t processId )
+		{
+			HANDLE process = OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId );
+			if ( !process )
+				return false;
+			DWORD exitCode = 0;
+			const bool alive = GetExitCodeProcess( process, &exitCode ) && exitCode == STILL_ACTIVE;
+			CloseHandle( process );
+			return alive;
+		}
+
+
+		// takes a free slot, or one left behind by a process that didn't shut down cleanly
+		Slot* claimSlot()
+		{
+			const uint32_t processId = GetCurrentProcessId();
+
+			for ( Slot& candidate : segment->slots )
+			{
+				uint32_t expected = 0;
+				if ( candidate.ownerProcessId.compare_exchange_strong( expected, processId ) )
+					return &candidate;
+			}
+
+			for ( Slot& candidate : segment->slots )
+			{
+				uint32_t owner = candidate.ownerProcessId.load();
+				if ( !isProcessAlive( owner ) && candidate.ownerProcessId.compare_exchange_strong( owner, processId ) )
+					return &candidate;
+			}
+			return nullptr;
+		}
+
+
+		uint32_t toMicroseconds( double seconds )
+		{
+			return uint32_t( std::min( std::fabs( seconds ) * 1e6, 4e9 ) );
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Telemetry
+{
+	void addSimulationSteps( int steps )
+	{
+		simulationSteps += steps;
+	}
+
+
+	void setActiveBalls( int count )
+	{
+		activeBalls = uint32_t( count );
+	}
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Telemetry
+{
+	void init()
+	{
+		assert( !segment );
+
+		mappingHandle = CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, DWORD( sizeof( Segment ) ), segmentName );
+		if ( !mappingHandle )
+			return;
+
+		segment = static_cast< Segment* >( MapViewOfFile( mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof( Segment ) ) );
+		if ( !segment )
+		{
+			deinit();
+			return;
+		}
+
+		segment->magic.store( segmentMagic );
+		segment->version.store( segmentVersion );
+		slot = claimSlot();
+
+		frame = 0;
+		simulationSteps = 0;
+		jitterWindowTime = 0.0;
+		jitterWindowMax = 0;
+		lastWindowMaxJitter = 0;
+	}
+
+
+	void deinit()
+	{
+		if ( slot )
+			slot->ownerProcessId.store( 0 );
+		if ( segment )
+			UnmapViewOfFile( segment );
+		if ( mappingHandle )
+			CloseHandle( mappingHandle );
+		slot = nullptr;
+		segment = nullptr;
+		mappingHandle = nullptr;
+	}
+
+
+	void publish( double frameTime, double targetFrameTime )
+	{
+		frame++;
+
+		const uint32_t jitter = toMicroseconds( frameTime - targetFrameTime );
+		jitterWindowMax = std::max( jitterWindowMax, jitter );
+		jitterWindowTime += frameTime;
+		if ( jitterWindowTime >= 1.0 )
+		{
+			lastWindowMaxJitter = jitterWindowMax;
+			jitterWindowMax = 0;
+			jitterWindowTime = 0.0;
+		}
+
+		if ( !slot )
+			return;
+
+		const uint32_t sequence = slot->sequence.load( std::memory_order_relaxed );
+		slot->sequence.store( sequence + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+
+		slot->frame.store( frame, std::memory_order_relaxed );
+		slot->simulationSteps.store( simulationSteps, std::memory_order_relaxed );
+		slot->frameTimeMicroseconds.store( toMicroseconds( frameTime ), std::memory_order_relaxed );
+		slot->jitterMicroseconds.store( jitter, std::memory_order_relaxed );
+		slot->maxJitterMicroseconds.store( lastWindowMaxJitter, std::memory_order_relaxed );
+		slot->activeBalls.store( activeBalls, std::memory_order_relaxed );
+
+		slot->sequence.store( sequence + 2, std::memory_order_release );
+	}
+}
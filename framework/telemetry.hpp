@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	user interface
+//-------------------------------------------------------
+
+namespace Telemetry
+{
+	void addSimulationSteps( int steps );
+	void setActiveBalls( int count );
+}
+
+
+//-------------------------------------------------------
+//	engine only interface
+//-------------------------------------------------------
+
+namespace Telemetry
+{
+	void init();
+	void deinit();
+
+	// publishes one frame, frameTime and targetFrameTime are in seconds
+	void publish( double frameTime, double targetFrameTime );
+}
+
+
+//-------------------------------------------------------
+//	shared memory layout, also used by external readers
+//-------------------------------------------------------
+
+namespace Telemetry
+{
+	constexpr const char* segmentName = "Local\\MiniBillTelemetry";
+	constexpr uint32_t segmentMagic = 0x544c424d;
+	constexpr uint32_t segmentVersion = 1;
+	constexpr int maxInstances = 64;
+
+
+	// One slot per running game. The owner updates it as a seqlock: sequence is odd while
+	// fields are being written, readers retry until they see the same even value before and after copying.
+	struct Slot
+	{
+		std::atomic< uint32_t > ownerProcessId;
+		std::atomic< uint32_t > sequence;
+
+		std::atomic< uint64_t > frame;
+		std::atomic< uint64_t > simulationSteps;
+		std::atomic< uint32_t > frameTimeMicroseconds;
+		// absolute difference between frame time and target frame time
+		std::atomic< uint32_t > jitterMicroseconds;
+		// largest jitter during the previous second
+		std::atomic< uint32_t > maxJitterMicroseconds;
+		std::atomic< uint32_t > activeBalls;
+	};
+
+
+	// plain copy of a slot taken by a reader
+	struct Sample
+	{
+		uint32_t ownerProcessId;
+		uint64_t frame;
+		uint64_t simulationSteps;
+		uint32_t frameTimeMicroseconds;
+		uint32_t jitterMicroseconds;
+		uint32_t maxJitterMicroseconds;
+		uint32_t activeBalls;
+	};
+
+
+	// segment memory starts zeroed, so an unused slot has no owner
+	struct Segment
+	{
+		std::atomic< uint32_t > magic;
+		std::atomic< uint32_t > version;
+		Slot slots[maxInstances];
+	};
+
+
+	// Processes built separately share the segment, so the atomics must be plain lock-free integers
+	// with no hidden lock and the layout fixed.
+	static_assert( ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "telemetry atomics must be lock free" );
+	static_assert( sizeof( std::atomic< uint32_t > ) == sizeof( uint32_t ) && sizeof( std::atomic< uint64_t > ) == sizeof( uint64_t ), "telemetry atomics must be plain integers" );
+	static_assert( offsetof( Slot, sequence ) == 4 && offsetof( Slot, frame ) == 8 && offsetof( Slot, simulationSteps ) == 16 &&
+				   offsetof( Slot, frameTimeMicroseconds ) == 24 && offsetof( Slot, jitterMicroseconds ) == 28 &&
+				   offsetof( Slot, maxJitterMicroseconds ) == 32 && offsetof( Slot, activeBalls ) == 36 && sizeof( Slot ) == 40, "telemetry slot layout changed" );
+	static_assert( offsetof( Segment, slots ) == 8 && sizeof( Segment ) == 8 + maxInstances * sizeof( Slot ), "telemetry segment layout changed" );
+
+
+	// returns false if the slot is unused or kept changing while being read
+	inline bool readSlot( Slot const& slot, Sample& sample )
+	{
+		for ( int attempt = 0; attempt < 16; attempt++ )
+		{
+			const uint32_t before = slot.sequence.load( std::memory_order_acquire );
+			if ( before & 1 )
+				continue;
+
+			sample.ownerProcessId = slot.ownerProcessId.load( std::memory_order_relaxed );
+			sample.frame = slot.frame.load( std::memory_order_relaxed );
+			sample.simulationSteps = slot.simulationSteps.load( std::memory_order_relaxed );
+			sample.frameTimeMicroseconds = slot.frameTimeMicroseconds.load( std::memory_order_relaxed );
+			sample.jitterMicroseconds = slot.jitterMicroseconds.load( std::memory_order_relaxed );
+			sample.maxJitterMicroseconds = slot.maxJitterMicroseconds.load( std::memory_order_relaxed );
+			sample.activeBalls = slot.activeBalls.load( std::memory_order_relaxed );
+
+			std::atomic_thread_fence( std::memory_order_acquire );
+			if ( slot.sequence.load( std::memory_order_relaxed ) == before )
+				return sample.ownerProcessId != 0;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,225 @@
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "aiming.hpp"
+#include "params.hpp"
+
+
+namespace
+{
+	// residual at which the target path is considered on the pocket
+	constexpr float angle_tolerance = 1e-4f;
+	// extra distance the target is given beyond the pocket
+	constexpr float power_margin = 1.f;
+	constexpr float power_increase = 1.3f;
+	// contacts are found at whole steps, so the residual jumps where the contact step changes and may have no root;
+	// a slightly different speed moves the jumps elsewhere
+	constexpr float speed_jitter = 0.95f;
+	constexpr int max_rounds = 5;
+	constexpr float min_bracket = 1e-6f;
+	// contacts thinner than this part of the possible range are not tried, a grazing ball can step past the target
+	constexpr float edge_fraction = 0.98f;
+
+	float cross(Vector2 const& a, Vector2 const& b) {
+		return a.x * b.y - a.y * b.x;
+	}
+
+	Vector2 direction(float angle) {
+		return Vector2(std::cos(angle), std::sin(angle));
+	}
+
+	float angle_of(Vector2 const& v) {
+		return std::atan2(v.y, v.x);
+	}
+
+	// speed squared lost per unit of distance: speed drops by friction each step while covering speed * dt
+	float friction_per_distance(float dt) {
+		return 2.f * Params::Ball::friction / dt;
+	}
+
+	// Pockets sit on the cushions, so a ball aimed at a pocket centre from an angle hits the cushion first.
+	// The point where the ball centre touches both cushions, or the side cushion, is inside the pocket and reachable.
+	Vector2 pocket_target(int pocket) {
+		const Vector2 centre = Params::Table::pocketsPositions[pocket];
+		const float max_x = 0.5f * Params::Table::width - Params::Ball::radius;
+		const float max_y = 0.5f * Params::Table::height - Params::Ball::radius;
+		return Vector2(std::max(-max_x, std::min(centre.x, max_x)), std::max(-max_y, std::min(centre.y, max_y)));
+	}
+
+	// balls keep the position where they were captured
+	int nearest_pocket(Vector2 position) {
+		int nearest = 0;
+		for (int i = 1; i < 6; i++) {
+			if (Abs(position - Params::Table::pocketsPositions[i]) < Abs(position - Params::Table::pocketsPositions[nearest])) {
+				nearest = i;
+			}
+		}
+		return nearest;
+	}
+
+	// Simulates until the target is first set in motion, by the cue ball or through other balls, and returns
+	// the signed angle from its path to the pocket. False when nothing reaches the target.
+	bool contact_residual(Physics::State const& state, int target, Vector2 pocket, Vector2 shot, float dt, int max_steps, float& residual) {
+		Physics::State s = state;
+		s.speeds.fill(Vector2(0, 0));
+		s.speeds[0] = shot;
+		std::array<bool, 7> pocketed;
+		for (int step = 0; step < max_steps && Physics::is_moving(s) && !s.scored[0]; step++) {
+			const Vector2 position = s.positions[target];
+			Physics::step(s, dt, pocketed);
+			if (s.speeds[target] || s.scored[target]) {
+				// a ball potted in the contact step has no speed left, its displacement gives the direction
+				const Vector2 path = s.scored[target] ? s.positions[target] - position : s.speeds[target];
+				const Vector2 wanted = pocket - s.positions[target];
+				residual = std::atan2(cross(path, wanted), Dot(path, wanted));
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+
+namespace Aiming
+{
+	Vector2 estimate_shot(Physics::State const& state, int target, int pocket, float dt) {
+		const Vector2 to_pocket = pocket_target(pocket) - state.positions[target];
+		const Vector2 line = to_pocket * (1.f / Abs(to_pocket));
+		const Vector2 ghost = state.positions[target] - line * (2 * Params::Ball::radius);
+		const Vector2 to_ghost = ghost - state.positions[0];
+		const float cue_distance = Abs(to_ghost);
+		const Vector2 aim = to_ghost * (1.f / cue_distance);
+
+		// the target leaves with the cue speed component along the line of centres
+		const float k = friction_per_distance(dt);
+		const float cut = std::max(Dot(aim, line), 0.1f);
+		const float target_speed_squared = k * (Abs(to_pocket) + power_margin);
+		const float speed = std::sqrt(target_speed_squared / (cut * cut) + k * cue_distance);
+		return aim * std::min(speed, Params::Shot::maxSpeed);
+	}
+
+
+	Solution solve(Physics::State const& state, int target, int pocket, float dt, int max_steps, int max_simulations) {
+		assert(target > 0 && target < 7 && !state.scored[target] && pocket >= 0 && pocket < 6);
+		assert(!Physics::is_moving(state));
+
+		const Vector2 aim_point = pocket_target(pocket);
+		const Vector2 to_target = state.positions[target] - state.positions[0];
+		const float centre_angle = angle_of(to_target);
+		const float half_range = std::asin(std::min(2 * Params::Ball::radius / Abs(to_target), 1.f));
+
+		const Vector2 estimate = estimate_shot(state, target, pocket, dt);
+		float speed = Abs(estimate);
+		// angles are kept relative to the full ball hit, so they never wrap
+		float ghost_offset = angle_of(estimate) - centre_angle;
+		ghost_offset = std::atan2(std::sin(ghost_offset), std::cos(ghost_offset));
+		const float side = ghost_offset < 0 ? -1.f : 1.f;
+
+		Solution solution;
+		solution.shot = estimate;
+		// closest offset to the pocket line among this round's probes that reached the target
+		bool hit = false;
+		float best_offset = 0.f, best_residual = 0.f;
+		auto residual_at = [&](float offset, float& residual) -> bool {
+			solution.simulations++;
+			if (!contact_residual(state, target, aim_point, direction(centre_angle + offset) * speed, dt, max_steps, residual)) {
+				return false;
+			}
+			if (!hit || std::fabs(residual) < std::fabs(best_residual)) {
+				best_offset = offset;
+				best_residual = residual;
+			}
+			hit = true;
+			return true;
+		};
+
+		float offset = ghost_offset;
+		for (int round = 0; round < max_rounds && solution.simulations < max_simulations; round++) {
+			// The residual goes monotonically from the cut angle at a full hit to about a right angle off at the edge
+			// on the ghost ball side, so the root is bracketed between them. Regula falsi with the Illinois
+			// correction converges superlinearly and can't leave the bracket.
+			hit = false;
+			float residual;
+			residual_at(offset, residual);
+			float full = 0.f, full_residual = 0.f;
+			float edge = side * edge_fraction * half_range, edge_residual = 0.f;
+			bool bracketed = false;
+			if (hit && std::fabs(residual) >= angle_tolerance && residual_at(full, full_residual)) {
+				if ((full_residual < 0) != (residual < 0)) {
+					edge = offset;
+					edge_residual = residual;
+					bracketed = true;
+				}
+				else {
+					full = offset;
+					full_residual = residual;
+					// a grazing shot may step through the target, come back toward the full hit until it touches
+					while (solution.simulations < max_simulations && !(bracketed = residual_at(edge, edge_residual))) {
+						edge = 0.5f * (edge + full);
+					}
+					bracketed = bracketed && (full_residual < 0) != (edge_residual < 0);
+				}
+			}
+
+			int last_side = 0;
+			bool lost = false;
+			while (bracketed && std::fabs(residual) >= angle_tolerance && std::fabs(edge - full) > min_bracket && solution.simulations < max_simulations) {
+				offset = (full * edge_residual - edge * full_residual) / (edge_residual - full_residual);
+				if (!residual_at(offset, residual)) {
+					lost = true;
+					break;
+				}
+				if ((residual < 0) == (full_residual < 0)) {
+					full = offset;
+					full_residual = residual;
+					if (last_side == -1) {
+						edge_residual *= 0.5f;
+					}
+					last_side = -1;
+				}
+				else {
+					edge = offset;
+					edge_residual = residual;
+					if (last_side == 1) {
+						full_residual *= 0.5f;
+					}
+					last_side = 1;
+				}
+			}
+			if (!hit) {
+				// nothing reached the target, a fuller contact is less likely to step past it
+				offset *= 0.5f;
+				continue;
+			}
+			// the probe that lost the target is no shot, fall back on the closest one that reached it
+			if (lost) {
+				offset = best_offset;
+				residual = best_residual;
+			}
+			solution.residual = residual;
+			solution.shot = direction(centre_angle + offset) * speed;
+			if (solution.simulations >= max_simulations) {
+				break;
+			}
+
+			Physics::State s = state;
+			s.speeds.fill(Vector2(0, 0));
+			s.speeds[0] = solution.shot;
+			Physics::simulate_to_rest(s, dt, max_steps);
+			solution.simulations++;
+			solution.pocketed = s.scored[target] && nearest_pocket(s.positions[target]) == pocket && !s.scored[0];
+			if (solution.pocketed) {
+				break;
+			}
+			// on line but short of the pocket needs power, off line needs another contact step
+			if (std::fabs(solution.residual) < angle_tolerance && speed < Params::Shot::maxSpeed) {
+				speed = std::min(speed * power_increase, Params::Shot::maxSpeed);
+			}
+			else {
+				speed *= speed_jitter;
+			}
+		}
+		return solution;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "vector2.hpp"
+#include "physics.hpp"
+
+
+//-------------------------------------------------------
+//	Shot solver for a chosen ball and pocket
+//-------------------------------------------------------
+
+namespace Aiming
+{
+	struct Solution
+	{
+		// cue ball velocity
+		Vector2 shot;
+		// the target went in the chosen pocket and the cue ball stayed on the table when the shot was simulated to rest
+		bool pocketed = false;
+		// radians between the target's path after contact and the pocket for the returned shot, 0 when nothing reached the target
+		float residual = 0.f;
+		// full or partial simulations spent
+		int simulations = 0;
+	};
+
+	// ghost ball estimate: the cue ball aims at the spot touching the target on the far side from the pocket,
+	// with the speed that carries the target past the pocket centre under the friction model
+	Vector2 estimate_shot(Physics::State const& state, int target, int pocket, float dt);
+
+	// refines the estimate by bracketed secant iterations on the cue angle, each one simulating until the target is set
+	// in motion, then checks the shot to rest and retries with another speed if it missed. The state must be at rest.
+	Solution solve(Physics::State const& state, int target, int pocket, float dt, int max_steps, int max_simulations = 24);
+}
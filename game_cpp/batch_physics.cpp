@@ -0,0 +1,337 @@
+#include <cassert>
+#include <algorithm>
+#include <emmintrin.h>
+
+#include "batch_physics.hpp"
+#include "params.hpp"
+
+
+//-------------------------------------------------------
+//	Eight float lanes
+//-------------------------------------------------------
+
+namespace
+{
+	// two SSE registers, SSE2 is available on every platform the project builds for
+	struct Lanes
+	{
+		__m128 lo;
+		__m128 hi;
+	};
+
+	static_assert(BatchPhysics::lanes == 8, "Lanes holds eight floats");
+
+	inline Lanes splat(float value) {
+		return { _mm_set1_ps(value), _mm_set1_ps(value) };
+	}
+
+	inline Lanes all_lanes(bool value) {
+		const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(value ? -1 : 0));
+		return { mask, mask };
+	}
+
+	inline Lanes load(const float* values) {
+		return { _mm_loadu_ps(values), _mm_loadu_ps(values + 4) };
+	}
+
+	inline void store(float* values, Lanes a) {
+		_mm_storeu_ps(values, a.lo);
+		_mm_storeu_ps(values + 4, a.hi);
+	}
+
+	inline Lanes operator+(Lanes a, Lanes b) {
+		return { _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator-(Lanes a, Lanes b) {
+		return { _mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator*(Lanes a, Lanes b) {
+		return { _mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator/(Lanes a, Lanes b) {
+		return { _mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes lanes_sqrt(Lanes a) {
+		return { _mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi) };
+	}
+
+	inline Lanes lanes_min(Lanes a, Lanes b) {
+		return { _mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi) };
+	}
+
+	// comparisons and masks: all bits of a lane set when true
+	inline Lanes operator<(Lanes a, Lanes b) {
+		return { _mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator>(Lanes a, Lanes b) {
+		return { _mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator==(Lanes a, Lanes b) {
+		return { _mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator!=(Lanes a, Lanes b) {
+		return { _mm_cmpneq_ps(a.lo, b.lo), _mm_cmpneq_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator&(Lanes a, Lanes b) {
+		return { _mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi) };
+	}
+
+	inline Lanes operator|(Lanes a, Lanes b) {
+		return { _mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi) };
+	}
+
+	// a & ~mask
+	inline Lanes and_not(Lanes a, Lanes mask) {
+		return { _mm_andnot_ps(mask.lo, a.lo), _mm_andnot_ps(mask.hi, a.hi) };
+	}
+
+	inline Lanes select(Lanes mask, Lanes a, Lanes b) {
+		return (mask & a) | and_not(b, mask);
+	}
+
+	// bit i is set when lane i is true
+	inline int lane_bits(Lanes mask) {
+		return _mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4);
+	}
+
+	inline Lanes lanes_from_bits(int bits) {
+		const __m128i lane_bit_lo = _mm_setr_epi32(1, 2, 4, 8);
+		const __m128i lane_bit_hi = _mm_setr_epi32(16, 32, 64, 128);
+		const __m128i all = _mm_set1_epi32(bits);
+		return { _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(all, lane_bit_lo), lane_bit_lo)),
+				 _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(all, lane_bit_hi), lane_bit_hi)) };
+	}
+}
+
+
+//-------------------------------------------------------
+//	Lane-parallel simulation step, mirrors physics.cpp
+//-------------------------------------------------------
+
+namespace
+{
+	struct Batch
+	{
+		Lanes px[7];
+		Lanes py[7];
+		Lanes vx[7];
+		Lanes vy[7];
+		Lanes scored[7];
+		// lanes where the ball didn't move during the last integration
+		Lanes still[7];
+		Lanes last_collision[7][7];
+		Lanes contacts[7][7];
+	};
+
+	// The distance field is a table lookup, so it's sampled lane by lane and the rest is vector math.
+	// A ball at rest that hasn't moved since its last check can't bounce or fall in, so it's skipped.
+	void check_boundaries(Batch& b, Lanes active) {
+		DistanceField const& rails = Physics::rail_field();
+		DistanceField const& pockets = Physics::pocket_field();
+
+		for (int i = 0; i < 7; ++i) {
+			Lanes at_rest = b.still[i] & (b.vx[i] == splat(0.f)) & (b.vy[i] == splat(0.f));
+			Lanes alive = and_not(and_not(active, b.scored[i]), at_rest);
+			const int alive_bits = lane_bits(alive);
+			if (!alive_bits) {
+				continue;
+			}
+
+			alignas(16) float x[8], y[8], rail_distance[8], gradient_x[8], gradient_y[8], pocket_distance[8];
+			store(x, b.px[i]);
+			store(y, b.py[i]);
+			for (int lane = 0; lane < 8; lane++) {
+				if (!((alive_bits >> lane) & 1)) {
+					// harmless values for masked lanes
+					rail_distance[lane] = pocket_distance[lane] = 1e9f;
+					gradient_x[lane] = 1.f;
+					gradient_y[lane] = 0.f;
+					continue;
+				}
+				DistanceField::Sample rail = rails.sample(Vector2(x[lane], y[lane]));
+				rail_distance[lane] = rail.distance;
+				gradient_x[lane] = rail.gradient.x;
+				gradient_y[lane] = rail.gradient.y;
+				pocket_distance[lane] = pockets.distance(Vector2(x[lane], y[lane]));
+			}
+
+			Lanes gx = load(gradient_x);
+			Lanes gy = load(gradient_y);
+			Lanes inverse_length = splat(1.f) / lanes_sqrt(gx * gx + gy * gy);
+			Lanes nx = gx * inverse_length;
+			Lanes ny = gy * inverse_length;
+			Lanes along = b.vx[i] * nx + b.vy[i] * ny;
+			Lanes reflect = alive & (load(rail_distance) < splat(Params::Ball::radius)) & (along < splat(0.f));
+			Lanes twice_along = splat(2.f) * along;
+			b.vx[i] = select(reflect, b.vx[i] - nx * twice_along, b.vx[i]);
+			b.vy[i] = select(reflect, b.vy[i] - ny * twice_along, b.vy[i]);
+
+			Lanes pocketed = alive & (load(pocket_distance) < splat(0.f));
+			b.scored[i] = b.scored[i] | pocketed;
+			b.vx[i] = and_not(b.vx[i], pocketed);
+			b.vy[i] = and_not(b.vy[i], pocketed);
+		}
+	}
+
+	void find_contacts(Batch& b, Lanes active) {
+		for (int i = 0; i < 7; ++i) {
+			for (int j = i + 1; j < 7; ++j) {
+				Lanes valid = and_not(and_not(active, b.scored[i]), b.scored[j]);
+				Lanes& counter = b.last_collision[i][j];
+				counter = select(valid, lanes_min(counter + splat(1.f), splat(10.f)), counter);
+
+				Lanes dx = b.px[i] - b.px[j];
+				Lanes dy = b.py[i] - b.py[j];
+				Lanes distance = lanes_sqrt(dx * dx + dy * dy);
+				Lanes apart = distance > splat(2 * Params::Ball::radius);
+				Lanes cooling_down = counter < splat(2.f);
+				b.contacts[i][j] = and_not(and_not(valid, apart), cooling_down);
+			}
+		}
+	}
+
+	// same rotation as collide_two_balls, applied only in lanes where the pair touches
+	void resolve_contacts(Batch& b) {
+		for (int i = 0; i < 7; ++i) {
+			for (int j = i + 1; j < 7; ++j) {
+				Lanes touching = b.contacts[i][j];
+				if (!lane_bits(touching)) {
+					continue;
+				}
+				Lanes dx = b.px[i] - b.px[j];
+				Lanes dy = b.py[i] - b.py[j];
+				Lanes distance = lanes_sqrt(dx * dx + dy * dy);
+				Lanes c = dx / distance;
+				Lanes s = dy / distance;
+				Lanes x1 = b.vx[i] * c + b.vy[i] * s;
+				Lanes y1 = b.vy[i] * c - b.vx[i] * s;
+				Lanes x2 = b.vx[j] * c + b.vy[j] * s;
+				Lanes y2 = b.vy[j] * c - b.vx[j] * s;
+				// x velocities are swapped
+				b.vx[i] = select(touching, x2 * c - y1 * s, b.vx[i]);
+				b.vy[i] = select(touching, x2 * s + y1 * c, b.vy[i]);
+				b.vx[j] = select(touching, x1 * c - y2 * s, b.vx[j]);
+				b.vy[j] = select(touching, x1 * s + y2 * c, b.vy[j]);
+				b.last_collision[i][j] = and_not(b.last_collision[i][j], touching);
+			}
+		}
+	}
+
+	void integrate(Batch& b, Lanes active, float dt) {
+		const Lanes step = splat(dt);
+		const Lanes friction = splat(Params::Ball::friction);
+		for (int i = 0; i < 7; ++i) {
+			b.still[i] = select(active, (b.vx[i] == splat(0.f)) & (b.vy[i] == splat(0.f)), b.still[i]);
+			b.px[i] = select(active, b.px[i] + b.vx[i] * step, b.px[i]);
+			b.py[i] = select(active, b.py[i] + b.vy[i] * step, b.py[i]);
+
+			Lanes speed = lanes_sqrt(b.vx[i] * b.vx[i] + b.vy[i] * b.vy[i]);
+			Lanes slowdown = friction / speed;
+			Lanes stops = speed < friction;
+			b.vx[i] = select(active, and_not(b.vx[i] - b.vx[i] * slowdown, stops), b.vx[i]);
+			b.vy[i] = select(active, and_not(b.vy[i] - b.vy[i] * slowdown, stops), b.vy[i]);
+		}
+	}
+
+	Lanes is_moving(Batch const& b) {
+		Lanes moving = all_lanes(false);
+		for (int i = 0; i < 7; ++i) {
+			moving = moving | (b.vx[i] != splat(0.f)) | (b.vy[i] != splat(0.f));
+		}
+		return moving;
+	}
+
+	void simulate_lanes(Physics::State const& state, Vector2 const* shots, int count, float dt, int max_steps, BatchPhysics::Result* results) {
+		assert(count > 0 && count <= BatchPhysics::lanes);
+
+		Batch b;
+		for (int i = 0; i < 7; ++i) {
+			b.px[i] = splat(state.positions[i].x);
+			b.py[i] = splat(state.positions[i].y);
+			b.vx[i] = splat(0.f);
+			b.vy[i] = splat(0.f);
+			b.scored[i] = all_lanes(state.scored[i]);
+			b.still[i] = all_lanes(false);
+			for (int j = i + 1; j < 7; ++j) {
+				b.last_collision[i][j] = splat(float(state.last_collision[i][j]));
+			}
+		}
+
+		alignas(16) float shot_x[8] = {}, shot_y[8] = {};
+		for (int lane = 0; lane < count; lane++) {
+			shot_x[lane] = shots[lane].x;
+			shot_y[lane] = shots[lane].y;
+		}
+		b.vx[0] = load(shot_x);
+		b.vy[0] = load(shot_y);
+
+		const Lanes used = lanes_from_bits((1 << count) - 1);
+		const Lanes limit = splat(float(max_steps));
+		Lanes steps = splat(0.f);
+		while (true) {
+			Lanes active = used & is_moving(b) & (steps < limit);
+			if (!lane_bits(active)) {
+				break;
+			}
+			check_boundaries(b, active);
+			find_contacts(b, active);
+			resolve_contacts(b);
+			integrate(b, active, dt);
+			steps = steps + (active & splat(1.f));
+		}
+
+		alignas(16) float values[8];
+		for (int i = 0; i < 7; ++i) {
+			store(values, b.px[i]);
+			for (int lane = 0; lane < count; lane++) {
+				results[lane].positions[i].x = values[lane];
+			}
+			store(values, b.py[i]);
+			for (int lane = 0; lane < count; lane++) {
+				results[lane].positions[i].y = values[lane];
+			}
+			const int scored_bits = lane_bits(b.scored[i]);
+			for (int lane = 0; lane < count; lane++) {
+				results[lane].scored[i] = ((scored_bits >> lane) & 1) != 0;
+			}
+		}
+		store(values, steps);
+		for (int lane = 0; lane < count; lane++) {
+			results[lane].steps = int(values[lane]);
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	BatchPhysics public interface
+//-------------------------------------------------------
+
+namespace BatchPhysics
+{
+	void simulate_shots(Physics::State const& state, Vector2 const* shots, int count, float dt, int max_steps, Result* results) {
+#if MINIBILL_FIXED_POINT_PHYSICS
+		// float lanes would break the match with Physics::step, shots run one by one in integer arithmetic
+		for (int k = 0; k < count; k++) {
+			Physics::State lane = state;
+			lane.speeds.fill(Vector2(0, 0));
+			lane.speeds[0] = shots[k];
+			results[k].steps = Physics::simulate_to_rest(lane, dt, max_steps);
+			results[k].positions = lane.positions;
+			results[k].scored = lane.scored;
+		}
+#else
+		for (int first = 0; first < count; first += lanes) {
+			simulate_lanes(state, shots + first, std::min(lanes, count - first), dt, max_steps, results + first);
+		}
+#endif
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+
+#include "vector2.hpp"
+#include "physics.hpp"
+
+
+//-------------------------------------------------------
+//	Many shots of one table, one shot per SIMD lane
+//-------------------------------------------------------
+
+namespace BatchPhysics
+{
+	constexpr int lanes = 8;
+
+	struct Result
+	{
+		std::array<Vector2, 7> positions;
+		std::array<bool, 7> scored;
+		int steps = 0;
+	};
+
+	// Applies each shot to the cue ball of the same resting state and simulates every lane to rest.
+	// Lanes follow Physics::step operation by operation, so each result matches Physics::simulate_to_rest;
+	// a lane whose balls stopped is masked out while the others keep going, so a batch costs as much as
+	// its longest shot and shots of similar strength are best passed next to each other.
+	void simulate_shots(Physics::State const& state, Vector2 const* shots, int count, float dt, int max_steps, Result* results);
+}
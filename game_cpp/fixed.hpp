@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "vector2.hpp"
+
+
+//-------------------------------------------------------
+//	Q16.16 fixed point numbers
+//-------------------------------------------------------
+
+// Integer arithmetic only, so every compiler and floating point setting gives the same bits.
+// Products and quotients go through 64 bits and truncate toward negative infinity for products,
+// toward zero for quotients.
+class Fixed
+{
+public:
+	static constexpr int fraction_bits = 16;
+	static constexpr int32_t one = 1 << fraction_bits;
+
+	int32_t raw = 0;
+
+	constexpr Fixed() = default;
+
+	static constexpr Fixed from_raw(int32_t raw) {
+		Fixed f;
+		f.raw = raw;
+		return f;
+	}
+	// nearest value, scaling by a power of two is exact so only the rounding is involved
+	static Fixed from_float(float value) {
+		return from_raw(int32_t(std::lround(value * float(one))));
+	}
+	// exact while |value| < 256, which covers positions and speeds on the table
+	float to_float() const {
+		return float(raw) * (1.f / float(one));
+	}
+
+	Fixed operator-() const { return from_raw(-raw); }
+	Fixed operator+(Fixed other) const { return from_raw(raw + other.raw); }
+	Fixed operator-(Fixed other) const { return from_raw(raw - other.raw); }
+	Fixed operator*(Fixed other) const { return from_raw(int32_t((int64_t(raw) * other.raw) >> fraction_bits)); }
+	Fixed operator/(Fixed other) const { return from_raw(int32_t(int64_t(raw) * one / other.raw)); }
+	Fixed& operator+=(Fixed other) { raw += other.raw; return *this; }
+	Fixed& operator-=(Fixed other) { raw -= other.raw; return *this; }
+
+	bool operator==(Fixed other) const { return raw == other.raw; }
+	bool operator!=(Fixed other) const { return raw != other.raw; }
+	bool operator<(Fixed other) const { return raw < other.raw; }
+	bool operator>(Fixed other) const { return raw > other.raw; }
+	bool operator<=(Fixed other) const { return raw <= other.raw; }
+	bool operator>=(Fixed other) const { return raw >= other.raw; }
+};
+
+static_assert((int64_t(-3) >> 1) == -2, "products rely on arithmetic right shift");
+
+
+class FixedVector2
+{
+public:
+	Fixed x;
+	Fixed y;
+
+	constexpr FixedVector2() = default;
+	constexpr FixedVector2(Fixed vx, Fixed vy) : x(vx), y(vy) {}
+
+	static FixedVector2 from_float(Vector2 v) {
+		return FixedVector2(Fixed::from_float(v.x), Fixed::from_float(v.y));
+	}
+	Vector2 to_float() const {
+		return Vector2(x.to_float(), y.to_float());
+	}
+
+	FixedVector2 operator+(FixedVector2 const& other) const { return FixedVector2(x + other.x, y + other.y); }
+	FixedVector2 operator-(FixedVector2 const& other) const { return FixedVector2(x - other.x, y - other.y); }
+	FixedVector2 operator*(Fixed k) const { return FixedVector2(x * k, y * k); }
+	FixedVector2& operator+=(FixedVector2 const& other) { x += other.x; y += other.y; return *this; }
+	FixedVector2& operator-=(FixedVector2 const& other) { x -= other.x; y -= other.y; return *this; }
+	explicit operator bool() const { return x.raw != 0 || y.raw != 0; }
+};
+
+
+// Q32.32 dot product, exact
+inline int64_t DotWide(FixedVector2 const& a, FixedVector2 const& b) {
+	return int64_t(a.x.raw) * b.x.raw + int64_t(a.y.raw) * b.y.raw;
+}
+
+// square root of a non negative Q32.32 value as Q16.16, rounded down
+inline Fixed SqrtWide(int64_t value) {
+	uint64_t remainder = uint64_t(value);
+	uint64_t root = 0;
+	uint64_t bit = uint64_t(1) << 62;
+	while (bit > remainder) {
+		bit >>= 2;
+	}
+	while (bit) {
+		if (remainder >= root + bit) {
+			remainder -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return Fixed::from_raw(int32_t(root));
+}
@@ -0,0 +1,229 @@
+#include <algorithm>
+
+#include "fixed_physics.hpp"
+#include "fixed.hpp"
+#include "params.hpp"
+
+
+//-------------------------------------------------------
+//	Table constants
+//-------------------------------------------------------
+
+namespace
+{
+	int64_t squared(Fixed value) {
+		return int64_t(value.raw) * value.raw;
+	}
+
+	struct Table
+	{
+		Fixed half_width = Fixed::from_float(0.5f * Params::Table::width);
+		Fixed half_height = Fixed::from_float(0.5f * Params::Table::height);
+		Fixed ball_radius = Fixed::from_float(Params::Ball::radius);
+		Fixed friction = Fixed::from_float(Params::Ball::friction);
+		int64_t friction_squared = squared(friction);
+		int64_t contact_squared = squared(ball_radius + ball_radius);
+		int64_t pocket_squared = squared(Fixed::from_float(Params::Table::pocketRadius));
+		std::array<FixedVector2, 6> pockets;
+
+		Table() {
+			for (int i = 0; i < 6; i++) {
+				pockets[i] = FixedVector2::from_float(Params::Table::pocketsPositions[i]);
+			}
+		}
+	};
+
+	Table const table;
+
+	struct Balls
+	{
+		std::array<FixedVector2, 7> positions;
+		std::array<FixedVector2, 7> speeds;
+	};
+
+	Fixed sign(Fixed value) {
+		return Fixed::from_raw(value.raw < 0 ? -Fixed::one : Fixed::one);
+	}
+}
+
+
+//-------------------------------------------------------
+//	Simulation phases
+//-------------------------------------------------------
+
+namespace
+{
+	// mirror of v along normal, which needn't be of unit length, false if v already moves away
+	bool reflect(FixedVector2& v, FixedVector2 const& normal) {
+		const int64_t along = DotWide(v, normal);
+		if (along >= 0) {
+			return false;
+		}
+		const int64_t norm = DotWide(normal, normal);
+		v.x -= Fixed::from_raw(int32_t(2 * normal.x.raw * along / norm));
+		v.y -= Fixed::from_raw(int32_t(2 * normal.y.raw * along / norm));
+		return true;
+	}
+
+	// cushion, depth past the contact with it and closing speed, in floats as events are only reported
+	PhysicsEvents::Event wall_event(int i, FixedVector2 const& position, Fixed dx, Fixed dy, FixedVector2 const& speed, FixedVector2 const& normal, float dt) {
+		const float x = dx.to_float(), y = dy.to_float();
+		const float distance = x >= 0 && y >= 0 ? std::min(x, y) : -Abs(Vector2(std::min(x, 0.f), std::min(y, 0.f)));
+		const Vector2 n = normal.to_float();
+		return PhysicsEvents::wall_event(i, position.to_float(), Params::Ball::radius - distance, -Dot(speed.to_float(), n) / Abs(n), dt);
+	}
+
+	void check_boundaries(Physics::State& state, Balls& balls, int i, std::array<bool, 7>& pocketed, PhysicsEvents::Ring* events, float dt) {
+		pocketed[i] = false;
+		if (state.scored[i]) {
+			return;
+		}
+		FixedVector2 const& p = balls.positions[i];
+		const Fixed dx = table.half_width - (p.x < Fixed() ? -p.x : p.x);
+		const Fixed dy = table.half_height - (p.y < Fixed() ? -p.y : p.y);
+
+		// inward normal of the nearest cushion, or of the corner once past both
+		FixedVector2 normal;
+		bool touching = true;
+		if (dx >= Fixed() && dy >= Fixed()) {
+			touching = std::min(dx, dy) < table.ball_radius;
+			normal = dx <= dy ? FixedVector2(-sign(p.x), Fixed()) : FixedVector2(Fixed(), -sign(p.y));
+		}
+		else if (dy >= Fixed()) {
+			normal = FixedVector2(-sign(p.x), Fixed());
+		}
+		else if (dx >= Fixed()) {
+			normal = FixedVector2(Fixed(), -sign(p.y));
+		}
+		else {
+			normal = FixedVector2(sign(p.x) * dx, sign(p.y) * dy);
+		}
+		if (touching) {
+			const FixedVector2 speed = balls.speeds[i];
+			if (reflect(balls.speeds[i], normal) && events) {
+				events->publish(wall_event(i, p, dx, dy, speed, normal, dt));
+			}
+		}
+
+		for (FixedVector2 const& pocket : table.pockets) {
+			if (DotWide(p - pocket, p - pocket) < table.pocket_squared) {
+				if (events) {
+					events->publish(PhysicsEvents::pocket_event(i, p.to_float(), balls.speeds[i].to_float(), dt));
+				}
+				state.scored[i] = true;
+				balls.speeds[i] = FixedVector2();
+				pocketed[i] = true;
+				return;
+			}
+		}
+	}
+
+	void collide_two_balls(Physics::State& state, Balls& balls, int i, int j, PhysicsEvents::Ring* events, float dt) {
+		state.last_collision[i][j] = 0;
+		// swapping the speed components along the line of centres, as the float rotation does
+		const FixedVector2 v = balls.positions[i] - balls.positions[j];
+		if (events) {
+			events->publish(PhysicsEvents::pair_event(i, j, v.to_float(), (balls.speeds[i] - balls.speeds[j]).to_float(), dt));
+		}
+		const int64_t norm = DotWide(v, v);
+		if (norm == 0) {
+			return;
+		}
+		const int64_t along = DotWide(balls.speeds[i] - balls.speeds[j], v);
+		const FixedVector2 exchange(Fixed::from_raw(int32_t(v.x.raw * along / norm)), Fixed::from_raw(int32_t(v.y.raw * along / norm)));
+		balls.speeds[i] -= exchange;
+		balls.speeds[j] += exchange;
+	}
+
+	// pairs found before any is resolved, as in the float path
+	struct Contacts
+	{
+		std::array<std::array<int, 7>, 7> partners;
+		std::array<int, 7> count;
+	};
+
+	void find_contacts(Physics::State& state, Balls const& balls, int i, Contacts& contacts) {
+		contacts.count[i] = 0;
+		for (int j = i + 1; j < 7; ++j) {
+			if (state.scored[j] || state.scored[i]) {
+				continue;
+			}
+			state.last_collision[i][j] = std::min(state.last_collision[i][j] + 1, 10);
+			const FixedVector2 v = balls.positions[i] - balls.positions[j];
+			if (DotWide(v, v) > table.contact_squared) {
+				continue;
+			}
+			if (state.last_collision[i][j] < 2) {
+				continue;
+			}
+			contacts.partners[i][contacts.count[i]++] = j;
+		}
+	}
+
+	void resolve_contacts(Physics::State& state, Balls& balls, Contacts const& contacts, PhysicsEvents::Ring* events, float dt) {
+		for (int i = 0; i < 7; ++i) {
+			for (int k = 0; k < contacts.count[i]; ++k) {
+				collide_two_balls(state, balls, i, contacts.partners[i][k], events, dt);
+			}
+		}
+	}
+
+	void move_ball(Balls& balls, int i, Fixed dt) {
+		balls.positions[i] += balls.speeds[i] * dt;
+	}
+
+	void apply_friction(Balls& balls, int i) {
+		FixedVector2& s = balls.speeds[i];
+		const int64_t speed_squared = DotWide(s, s);
+		if (speed_squared < table.friction_squared) {
+			s = FixedVector2();
+			return;
+		}
+		s -= s * (table.friction / SqrtWide(speed_squared));
+	}
+}
+
+
+//-------------------------------------------------------
+//	FixedPhysics public interface
+//-------------------------------------------------------
+
+namespace FixedPhysics
+{
+	void step(Physics::State& state, float dt, std::array<bool, 7>& pocketed, PhysicsEvents::Ring* events) {
+		Balls balls;
+		for (int i = 0; i < 7; i++) {
+			balls.positions[i] = FixedVector2::from_float(state.positions[i]);
+			balls.speeds[i] = FixedVector2::from_float(state.speeds[i]);
+		}
+
+		Contacts contacts;
+		for (int i = 0; i < 7; i++) {
+			check_boundaries(state, balls, i, pocketed, events, dt);
+		}
+		for (int i = 0; i < 7; i++) {
+			find_contacts(state, balls, i, contacts);
+		}
+		resolve_contacts(state, balls, contacts, events, dt);
+		const Fixed fixed_dt = Fixed::from_float(dt);
+		for (int i = 0; i < 7; i++) {
+			move_ball(balls, i, fixed_dt);
+			apply_friction(balls, i);
+		}
+
+		for (int i = 0; i < 7; i++) {
+			state.positions[i] = balls.positions[i].to_float();
+			state.speeds[i] = balls.speeds[i].to_float();
+		}
+	}
+
+	int simulate_to_rest(Physics::State& state, float dt, int max_steps) {
+		std::array<bool, 7> pocketed;
+		int steps = 0;
+		while (steps < max_steps && Physics::is_moving(state)) {
+			FixedPhysics::step(state, dt, pocketed);
+			steps++;
+		}
+		return steps;
+	}
+}
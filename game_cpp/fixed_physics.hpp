@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+
+#include "physics.hpp"
+
+
+//-------------------------------------------------------
+//	Table simulation in Q16.16 integer arithmetic
+//-------------------------------------------------------
+
+// Same phases as Physics::step, with the cushions and pockets tested analytically instead of through
+// the baked distance fields and no square root outside friction, which uses an integer one.
+// States are read and written as floats: every Q16.16 value of the table fits a float mantissa,
+// so after the first step the round trip is exact and replays match bit for bit on any build.
+// Each ball runs the same straight integer sequence, suited to integer SIMD lanes.
+// Events are only reported, in floats, and don't feed back into the state.
+namespace FixedPhysics
+{
+	void step(Physics::State& state, float dt, std::array<bool, 7>& pocketed, PhysicsEvents::Ring* events = nullptr);
+
+	int simulate_to_rest(Physics::State& state, float dt, int max_steps);
+}
@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "opening_book.hpp"
+
+
+namespace
+{
+	char const magic[4] = { 'M', 'B', 'O', 'B' };
+	uint32_t const version = 1;
+}
+
+
+bool OpeningBook::open(char const* path)
+{
+	close();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	if (file.size() < sizeof(Header)) {
+		close();
+		return false;
+	}
+	Header const* candidate = reinterpret_cast<Header const*>(file.data());
+	// 32 bit counts of small records can't overflow 64 bits, a size_t may be 32 bits
+	static_assert(sizeof(Entry) < (1u << 16) && sizeof(Shot) < (1u << 16), "records too large for the size check");
+	const uint64_t expected_size = sizeof(Header) + sizeof(Entry) * uint64_t(candidate->position_count) + sizeof(Shot) * uint64_t(candidate->shot_count);
+	if (std::memcmp(candidate->magic, magic, sizeof(magic)) || candidate->version != version || candidate->position_step <= 0.f || uint64_t(file.size()) != expected_size) {
+		close();
+		return false;
+	}
+
+	header = candidate;
+	entries = reinterpret_cast<Entry const*>(file.data() + sizeof(Header));
+	shots = reinterpret_cast<Shot const*>(entries + header->position_count);
+	return true;
+}
+
+
+void OpeningBook::close()
+{
+	file.close();
+	header = nullptr;
+	entries = nullptr;
+	shots = nullptr;
+}
+
+
+bool OpeningBook::is_open() const
+{
+	return header != nullptr;
+}
+
+
+int OpeningBook::position_count() const
+{
+	return header ? int(header->position_count) : 0;
+}
+
+
+OpeningBook::Shots OpeningBook::find(Physics::State const& state) const
+{
+	Shots found;
+	if (!header) {
+		return found;
+	}
+
+	const PositionKey::Key key = PositionKey::make(state, 1.f / header->position_step);
+	Entry const* last = entries + header->position_count;
+	Entry const* entry = std::lower_bound(entries, last, key, [](Entry const& e, PositionKey::Key const& k) { return e.key < k; });
+	if (entry == last || entry->key != key) {
+		return found;
+	}
+
+	// a corrupted entry reads as a miss rather than outside the mapping
+	if (entry->first_shot > header->shot_count || entry->shot_count > header->shot_count - entry->first_shot) {
+		return found;
+	}
+	found.first = shots + entry->first_shot;
+	found.count = int(entry->shot_count);
+	return found;
+}
+
+
+OpeningBook::Builder::Builder(float position_step) :
+	position_step(position_step)
+{
+}
+
+
+void OpeningBook::Builder::add(Physics::State const& state, std::vector<Shot> const& ranked_shots)
+{
+	positions.emplace_back(PositionKey::make(state, 1.f / position_step), ranked_shots);
+}
+
+
+bool OpeningBook::Builder::write(char const* path) const
+{
+	// latest addition first among equal keys, so unique() keeps it
+	std::vector<int> order(positions.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = int(order.size() - 1 - i);
+	}
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return positions[a].first < positions[b].first; });
+	order.erase(std::unique(order.begin(), order.end(), [this](int a, int b) { return positions[a].first == positions[b].first; }), order.end());
+
+	Header out_header = {};
+	std::memcpy(out_header.magic, magic, sizeof(magic));
+	out_header.version = version;
+	out_header.position_step = position_step;
+	out_header.position_count = uint32_t(order.size());
+
+	std::vector<Entry> out_entries;
+	out_entries.reserve(order.size());
+	for (int index : order) {
+		Entry entry;
+		entry.key = positions[index].first;
+		entry.first_shot = out_header.shot_count;
+		entry.shot_count = uint32_t(positions[index].second.size());
+		out_header.shot_count += entry.shot_count;
+		out_entries.push_back(entry);
+	}
+
+	FILE* out = std::fopen(path, "wb");
+	if (!out) {
+		return false;
+	}
+	bool ok = std::fwrite(&out_header, sizeof(out_header), 1, out) == 1;
+	ok = ok && (out_entries.empty() || std::fwrite(out_entries.data(), sizeof(Entry), out_entries.size(), out) == out_entries.size());
+	for (int index : order) {
+		std::vector<Shot> const& ranked = positions[index].second;
+		ok = ok && (ranked.empty() || std::fwrite(ranked.data(), sizeof(Shot), ranked.size(), out) == ranked.size());
+	}
+	return std::fclose(out) == 0 && ok;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "../framework/mapped_file.hpp"
+
+#include "vector2.hpp"
+#include "physics.hpp"
+#include "position_key.hpp"
+
+
+//-------------------------------------------------------
+//	Precomputed shots for known table positions
+//-------------------------------------------------------
+
+// The file is read through a memory mapping and used in place: a header, position entries sorted
+// by key, then the ranked shots of all positions. Values are stored in native little endian layout.
+class OpeningBook
+{
+public:
+	struct Shot
+	{
+		float velocity_x;
+		float velocity_y;
+		// higher is better
+		float score;
+		// balls pocketed once the table came to rest
+		uint32_t scored_mask;
+	};
+
+	struct Shots
+	{
+		Shot const* first = nullptr;
+		int count = 0;
+
+		Shot const* begin() const { return first; }
+		Shot const* end() const { return first + count; }
+		bool empty() const { return count == 0; }
+	};
+
+	OpeningBook() = default;
+	OpeningBook(OpeningBook const&) = delete;
+
+	// only checks the header and the file size, entries are paged in when searched
+	bool open(char const* path);
+	void close();
+	bool is_open() const;
+
+	int position_count() const;
+
+	// ranked best first, empty when the resting state isn't in the book
+	Shots find(Physics::State const& state) const;
+
+
+	// collects positions in memory, then writes a book file
+	class Builder
+	{
+	public:
+		explicit Builder(float position_step = 0.01f);
+
+		// a position added twice keeps the last shots
+		void add(Physics::State const& state, std::vector<Shot> const& ranked_shots);
+		bool write(char const* path) const;
+
+	private:
+		float const position_step;
+		std::vector<std::pair<PositionKey::Key, std::vector<Shot>>> positions;
+	};
+
+private:
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		float position_step;
+		uint32_t position_count;
+		uint32_t shot_count;
+		uint32_t reserved;
+	};
+
+	struct Entry
+	{
+		PositionKey::Key key;
+		uint32_t first_shot;
+		uint32_t shot_count;
+	};
+
+	MappedFile file;
+	Header const* header = nullptr;
+	Entry const* entries = nullptr;
+	Shot const* shots = nullptr;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+
+#include "vector2.hpp"
+
+
+//-------------------------------------------------------
+//	game parameters
+//-------------------------------------------------------
+
+namespace Params
+{
+	namespace System
+	{
+		constexpr int targetFPS = 60;
+		// records ball trajectories to trajectories_<date>_<time>_<n>.mbta, one file from game init to deinit
+		constexpr bool recordTrajectories = false;
+	}
+
+	namespace Table
+	{
+		constexpr float width = 15.f;
+		constexpr float height = 8.f;
+		constexpr float pocketRadius = 0.4f;
+		// corner pocket are moved a bit because balls don't fit otherwise
+		static constexpr std::array< Vector2, 6 > pocketsPositions =
+		{
+			Vector2{ -0.5f * width + 0.1f, -0.5f * height + 0.1f },
+			Vector2{ 0.f, -0.5f * height },
+			Vector2{ 0.5f * width - 0.1f, -0.5f * height + 0.1f },
+			Vector2{ -0.5f * width + 0.1f, 0.5f * height - 0.1f },
+			Vector2{ 0.f, 0.5f * height },
+			Vector2{ 0.5f * width - 0.1f, 0.5f * height - 0.1f}
+		};
+
+		static constexpr std::array< Vector2, 7 > ballsPositions =
+		{
+			// player ball
+			Vector2(-0.3f * width, 0.f),
+			// other balls
+			Vector2(0.2f * width, 0.f),
+			Vector2(0.25f * width, 0.05f * height),
+			Vector2(0.25f * width, -0.05f * height),
+			Vector2(0.3f * width, 0.1f * height),
+			Vector2(0.3f * width, 0.f),
+			Vector2(0.3f * width, -0.1f * height)
+		};
+	}
+
+	namespace Ball
+	{
+		constexpr float radius = 0.3f;
+		constexpr float friction = 0.01f;
+	}
+
+	namespace Shot
+	{
+		constexpr float chargeTime = 1.f;
+		// cue ball speed of a fully charged shot
+		constexpr float maxSpeed = 6.f;
+	}
+}
@@ -0,0 +1,231 @@
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "physics.hpp"
+#include "params.hpp"
+#include "table_sdf.hpp"
+#include "fixed_physics.hpp"
+
+
+//-------------------------------------------------------
+//	Table geometry
+//-------------------------------------------------------
+
+namespace
+{
+	namespace Geometry
+	{
+		constexpr float cellSize = 0.05f;
+		constexpr float margin = 1.f;
+
+		// distance from a ball centre to the cushions, positive on the table
+		float rail_distance(Vector2 p) {
+			float dx = 0.5f * Params::Table::width - std::abs(p.x);
+			float dy = 0.5f * Params::Table::height - std::abs(p.y);
+			if (dx >= 0 && dy >= 0) {
+				return std::min(dx, dy);
+			}
+			return -Abs(Vector2(std::min(dx, 0.f), std::min(dy, 0.f)));
+		}
+
+		// distance to the nearest pocket, negative when a ball centre is inside one
+		float pocket_distance(Vector2 p) {
+			float distance = Abs(p - Params::Table::pocketsPositions[0]);
+			for (const auto& pocket : Params::Table::pocketsPositions) {
+				distance = std::min(distance, Abs(p - pocket));
+			}
+			return distance - Params::Table::pocketRadius;
+		}
+
+		DistanceField rails;
+		DistanceField pockets;
+
+		// shapes are baked once, lookups are O(1) whatever the shapes are
+		void bake() {
+			if (rails.isBaked()) {
+				return;
+			}
+			Vector2 max(0.5f * Params::Table::width + margin, 0.5f * Params::Table::height + margin);
+			rails.bake(max * -1.f, max, cellSize, rail_distance);
+			pockets.bake(max * -1.f, max, cellSize, pocket_distance);
+		}
+	}
+
+
+}
+
+
+//-------------------------------------------------------
+//	Simulation phases
+//-------------------------------------------------------
+
+namespace
+{
+	// pairs found by the broad phase, row i holds partners j > i of ball i
+	struct Contacts
+	{
+		std::array<std::array<int, 7>, 7> partners;
+		std::array<int, 7> count;
+	};
+
+	// walls and pockets only touch ball i
+	void check_boundaries(Physics::State& state, int i, std::array<bool, 7>& pocketed, PhysicsEvents::Ring* events, float dt) {
+		pocketed[i] = false;
+		if (state.scored[i]) {
+			return;
+		}
+		DistanceField::Sample rail = Geometry::rails.sample(state.positions[i]);
+		if (rail.distance < Params::Ball::radius) {
+			// reflect off the cushion unless the ball already moves away from it
+			Vector2 normal = rail.gradient * (1.f / Abs(rail.gradient));
+			float along = Dot(state.speeds[i], normal);
+			if (along < 0) {
+				state.speeds[i] -= normal * (2 * along);
+				if (events) {
+					events->publish(PhysicsEvents::wall_event(i, state.positions[i], Params::Ball::radius - rail.distance, -along, dt));
+				}
+			}
+		}
+		if (Geometry::pockets.distance(state.positions[i]) < 0) {
+			if (events) {
+				events->publish(PhysicsEvents::pocket_event(i, state.positions[i], state.speeds[i], dt));
+			}
+			state.scored[i] = true;
+			state.speeds[i] = Vector2(0, 0);
+			pocketed[i] = true;
+		}
+	}
+
+	// positions don't change while resolving, so the pair tests only write row i
+	void find_contacts(Physics::State& state, int i, Contacts& contacts) {
+		contacts.count[i] = 0;
+		for (int j = i + 1; j < 7; ++j) {
+			if (state.scored[j] || state.scored[i]) {
+				continue;
+			}
+			state.last_collision[i][j] = std::min(state.last_collision[i][j] + 1, 10); // to prevent overflow after one year of no collisions
+			Vector2 v = state.positions[i] - state.positions[j];
+			if (Abs(v) > 2 * Params::Ball::radius) {
+				continue;
+			}
+			if (state.last_collision[i][j] < 2) { // this prevents balls from "colliding" again after already going in different derections
+				continue;
+			}
+			contacts.partners[i][contacts.count[i]++] = j;
+		}
+	}
+
+	void collide_two_balls(Physics::State& state, int i, int j, PhysicsEvents::Ring* events, float dt) {
+		Vector2 v = state.positions[i] - state.positions[j];
+		if (events) {
+			events->publish(PhysicsEvents::pair_event(i, j, v, state.speeds[i] - state.speeds[j], dt));
+		}
+		// firstly, we change the axes to make collision horisontal
+		float c = v.x / Abs(v); // cos
+		float s = v.y / Abs(v);  // sin
+		float x1 = state.speeds[i].x * c + state.speeds[i].y * s;
+		float y1 = -state.speeds[i].x * s + state.speeds[i].y * c;
+		float x2 = state.speeds[j].x * c + state.speeds[j].y * s;
+		float y2 = -state.speeds[j].x * s + state.speeds[j].y * c;
+		// after the collision Y velocities stay the same because forces are horisontal
+		// X velocities are swapped because masses are the same
+		std::swap(x1, x2);
+		// change the axes back
+		state.speeds[i].x = x1 * c - y1 * s;
+		state.speeds[i].y = x1 * s + y1 * c;
+		state.speeds[j].x = x2 * c - y2 * s;
+		state.speeds[j].y = x2 * s + y2 * c;
+		state.last_collision[i][j] = 0;
+	}
+
+	// a ball can be in several contacts, so they are resolved on one thread in fixed order
+	void resolve_contacts(Physics::State& state, Contacts const& contacts, PhysicsEvents::Ring* events, float dt) {
+		for (int i = 0; i < 7; ++i) {
+			for (int k = 0; k < contacts.count[i]; ++k) {
+				collide_two_balls(state, i, contacts.partners[i][k], events, dt);
+			}
+		}
+	}
+
+	void move_ball(Physics::State& state, int i, float dt) {
+		state.positions[i] += state.speeds[i] * dt;
+	}
+
+	void apply_friction(Physics::State& state, int i) {
+		if (Abs(state.speeds[i]) < Params::Ball::friction) {
+			state.speeds[i] = Vector2(0, 0);
+		}
+		else {
+			state.speeds[i] -= state.speeds[i] * (Params::Ball::friction / Abs(state.speeds[i]));
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	Physics public interface
+//-------------------------------------------------------
+
+namespace Physics
+{
+	void init() {
+		Geometry::bake();
+	}
+
+	void reset(State& state) {
+		state.positions = Params::Table::ballsPositions;
+		state.speeds.fill(Vector2(0, 0));
+		state.scored.fill(false);
+		for (auto& arr : state.last_collision) {
+			arr.fill(3);
+		}
+	}
+
+	void step(State& state, float dt, std::array<bool, 7>& pocketed, PhysicsEvents::Ring* events) {
+#if MINIBILL_FIXED_POINT_PHYSICS
+		FixedPhysics::step(state, dt, pocketed, events);
+#else
+		// seven balls are far too few to pay for jobs, callers parallelise across shots instead
+		Contacts contacts;
+		for (int i = 0; i < 7; i++) {
+			check_boundaries(state, i, pocketed, events, dt);
+		}
+		for (int i = 0; i < 7; i++) {
+			find_contacts(state, i, contacts);
+		}
+		resolve_contacts(state, contacts, events, dt);
+		for (int i = 0; i < 7; i++) {
+			move_ball(state, i, dt);
+			apply_friction(state, i);
+		}
+#endif
+	}
+
+	bool is_moving(State const& state) {
+		for (int i = 0; i < 7; i++) {
+			if (state.speeds[i]) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int simulate_to_rest(State& state, float dt, int max_steps) {
+		std::array<bool, 7> pocketed;
+		int steps = 0;
+		while (steps < max_steps && is_moving(state)) {
+			step(state, dt, pocketed);
+			steps++;
+		}
+		return steps;
+	}
+
+	DistanceField const& rail_field() {
+		return Geometry::rails;
+	}
+
+	DistanceField const& pocket_field() {
+		return Geometry::pockets;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+
+#include "vector2.hpp"
+#include "table_sdf.hpp"
+#include "physics_events.hpp"
+
+
+// 1 runs steps in Q16.16 integer arithmetic, identical on every build, see fixed_physics.hpp
+#ifndef MINIBILL_FIXED_POINT_PHYSICS
+#define MINIBILL_FIXED_POINT_PHYSICS 0
+#endif
+
+
+//-------------------------------------------------------
+//	Table simulation, independent from the scene
+//-------------------------------------------------------
+
+namespace Physics
+{
+	struct State
+	{
+		std::array<Vector2, 7> positions;
+		std::array<Vector2, 7> speeds;
+		std::array<bool, 7> scored;
+		std::array<std::array<int, 7>, 7> last_collision;
+	};
+
+	// bakes table geometry, must be called before the first step
+	void init();
+
+	// opening layout, all balls at rest
+	void reset(State& state);
+
+	// advances the state by dt, pocketed[i] is set for balls pocketed during this step.
+	// Runs on the calling thread, so independent states can be stepped on several threads at once.
+	// Cushion, pocket and pair contacts are published to events if given, in a fixed order.
+	void step(State& state, float dt, std::array<bool, 7>& pocketed, PhysicsEvents::Ring* events = nullptr);
+
+	bool is_moving(State const& state);
+
+	// steps with fixed dt until all balls stop or max_steps is reached, returns the number of steps
+	int simulate_to_rest(State& state, float dt, int max_steps);
+
+	// baked table geometry, for kernels that step balls on their own
+	DistanceField const& rail_field();
+	DistanceField const& pocket_field();
+}
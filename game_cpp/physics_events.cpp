@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "physics_events.hpp"
+#include "params.hpp"
+
+
+namespace
+{
+	float clamp_age(float age, float dt) {
+		return std::max(0.f, std::min(age, dt));
+	}
+}
+
+
+//-------------------------------------------------------
+//	Events
+//-------------------------------------------------------
+
+namespace PhysicsEvents
+{
+	Event pair_event(int i, int j, Vector2 offset, Vector2 relative_speed, float dt) {
+		Event event;
+		event.type = Type::pair;
+		event.ball = uint8_t(i);
+		event.other = uint8_t(j);
+		const float distance = Abs(offset);
+		const float along = Dot(offset, relative_speed);
+		event.impact_speed = distance > 0 ? std::max(-along / distance, 0.f) : 0.f;
+
+		// going back along the relative speed, the centres were two radii apart at the positive root
+		const float contact = 2 * Params::Ball::radius;
+		const float speed_squared = Dot(relative_speed, relative_speed);
+		const float discriminant = along * along - speed_squared * (distance * distance - contact * contact);
+		if (speed_squared > 0 && discriminant >= 0) {
+			event.age = clamp_age((along + std::sqrt(discriminant)) / speed_squared, dt);
+		}
+		return event;
+	}
+
+	Event wall_event(int ball, Vector2 position, float depth, float normal_speed, float dt) {
+		Event event;
+		event.type = Type::wall;
+		event.ball = uint8_t(ball);
+		// the cushion nearest to the ball centre, the long ones in a corner where both are as near
+		const float dx = 0.5f * Params::Table::width - std::abs(position.x);
+		const float dy = 0.5f * Params::Table::height - std::abs(position.y);
+		const Cushion cushion = dy <= dx ? (position.y < 0 ? Cushion::bottom : Cushion::top) : (position.x < 0 ? Cushion::left : Cushion::right);
+		event.other = uint8_t(cushion);
+		event.impact_speed = normal_speed;
+		event.age = normal_speed > 0 ? clamp_age(depth / normal_speed, dt) : 0.f;
+		return event;
+	}
+
+	Event pocket_event(int ball, Vector2 position, Vector2 speed, float dt) {
+		Event event;
+		event.type = Type::pocket;
+		event.ball = uint8_t(ball);
+		float distance = Abs(position - Params::Table::pocketsPositions[0]);
+		for (int i = 1; i < 6; i++) {
+			const float d = Abs(position - Params::Table::pocketsPositions[i]);
+			if (d < distance) {
+				distance = d;
+				event.other = uint8_t(i);
+			}
+		}
+		event.impact_speed = Abs(speed);
+		event.age = event.impact_speed > 0 ? clamp_age((Params::Table::pocketRadius - distance) / event.impact_speed, dt) : 0.f;
+		return event;
+	}
+}
+
+
+//-------------------------------------------------------
+//	Ring
+//-------------------------------------------------------
+
+namespace PhysicsEvents
+{
+	void Ring::publish(Event const& event) {
+		const uint64_t n = head.load(std::memory_order_relaxed);
+		Slot& slot = slots[n & (capacity - 1)];
+
+		uint32_t copy[words] = {};
+		std::memcpy(copy, &event, sizeof(event));
+		slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (int k = 0; k < words; k++) {
+			slot.data[k].store(copy[k], std::memory_order_relaxed);
+		}
+		slot.sequence.store(2 * (n + 1), std::memory_order_release);
+		head.store(n + 1, std::memory_order_release);
+	}
+
+	uint64_t Ring::published() const {
+		return head.load(std::memory_order_acquire);
+	}
+
+
+	Reader::Reader(Ring const& ring)
+		: ring(ring), cursor(ring.published()) {
+	}
+
+	bool Reader::next(Event& event) {
+		while (true) {
+			const uint64_t head = ring.head.load(std::memory_order_acquire);
+			if (cursor == head) {
+				return false;
+			}
+			if (head - cursor > Ring::capacity) {
+				lost += head - cursor - Ring::capacity;
+				cursor = head - Ring::capacity;
+			}
+
+			Ring::Slot const& slot = ring.slots[cursor & (Ring::capacity - 1)];
+			const uint64_t expected = 2 * (cursor + 1);
+			if (slot.sequence.load(std::memory_order_acquire) == expected) {
+				uint32_t copy[Ring::words];
+				for (int k = 0; k < Ring::words; k++) {
+					copy[k] = slot.data[k].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+					std::memcpy(&event, copy, sizeof(event));
+					cursor++;
+					return true;
+				}
+			}
+			// the writer has already reused the slot, the event is gone
+			lost++;
+			cursor++;
+		}
+	}
+
+	uint64_t Reader::dropped() const {
+		return lost;
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "vector2.hpp"
+
+
+//-------------------------------------------------------
+//	Contact events published by the simulation
+//-------------------------------------------------------
+
+namespace PhysicsEvents
+{
+	enum class Type : uint8_t
+	{
+		pair,
+		wall,
+		pocket
+	};
+
+	// cushions by the side of the table they run along, bottom is at negative y
+	enum class Cushion : uint8_t
+	{
+		bottom,
+		right,
+		top,
+		left
+	};
+
+	struct Event
+	{
+		Type type = Type::pair;
+		uint8_t ball = 0;
+		// partner ball for a pair, Cushion for a wall, pocket index for a pocket
+		uint8_t other = 0;
+		// closing speed along the line of centres or the cushion normal, ball speed when pocketed
+		float impact_speed = 0.f;
+		// Contacts are found once the balls already overlap: seconds between the contact and the start
+		// of the step that reported it, from 0 to dt
+		float age = 0.f;
+	};
+
+	// events as found by the steps, computed the same way by the float and the fixed point paths
+	Event pair_event(int i, int j, Vector2 offset, Vector2 relative_speed, float dt);
+	Event wall_event(int ball, Vector2 position, float depth, float normal_speed, float dt);
+	Event pocket_event(int ball, Vector2 position, Vector2 speed, float dt);
+
+
+	// Broadcast ring: one thread publishes, any number of readers follow it at their own pace from any thread.
+	// Nothing blocks and nothing is allocated; a reader that falls more than capacity events behind loses
+	// the oldest ones and is told how many.
+	class Ring
+	{
+	public:
+		static constexpr uint32_t capacity = 1024;
+
+		Ring() = default;
+		Ring(Ring const&) = delete;
+
+		// producer thread only
+		void publish(Event const& event);
+
+		// number of events published so far
+		uint64_t published() const;
+
+	private:
+		friend class Reader;
+
+		static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+		static constexpr int words = (sizeof(Event) + 3) / 4;
+
+		// Each slot is a seqlock: sequence is odd while the event is written, then 2 * (n + 1) once
+		// it holds event n. The words are atomics so a reader racing the writer is well defined.
+		struct Slot
+		{
+			std::atomic<uint64_t> sequence{ 0 };
+			std::array<std::atomic<uint32_t>, words> data = {};
+		};
+
+		std::array<Slot, capacity> slots;
+		alignas(64) std::atomic<uint64_t> head{ 0 };
+	};
+
+
+	// One consumer's cursor, used by a single thread. Starts with the next event published.
+	class Reader
+	{
+	public:
+		explicit Reader(Ring const& ring);
+
+		// false when the reader has caught up with the ring
+		bool next(Event& event);
+
+		// events overwritten before this reader got to them
+		uint64_t dropped() const;
+
+	private:
+		Ring const& ring;
+		uint64_t cursor;
+		uint64_t lost = 0;
+	};
+}
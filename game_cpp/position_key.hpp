@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "physics.hpp"
+
+
+//-------------------------------------------------------
+//	Quantized table positions used as lookup keys
+//-------------------------------------------------------
+
+namespace PositionKey
+{
+	// ball coordinates in steps of the quantization, then the scored mask; compared as a whole
+	using Key = std::array<int32_t, 15>;
+
+	inline Key make(Physics::State const& state, float inverse_position_step) {
+		Key key;
+		uint32_t scored_mask = 0;
+		for (int i = 0; i < 7; i++) {
+			// pocketed balls keep whatever position they had, it mustn't split entries
+			if (state.scored[i]) {
+				scored_mask |= 1u << i;
+				key[2 * i] = 0;
+				key[2 * i + 1] = 0;
+			}
+			else {
+				key[2 * i] = int32_t(std::lround(state.positions[i].x * inverse_position_step));
+				key[2 * i + 1] = int32_t(std::lround(state.positions[i].y * inverse_position_step));
+			}
+		}
+		key[14] = int32_t(scored_mask);
+		return key;
+	}
+}
@@ -0,0 +1,213 @@
+#include <cassert>
+#include <cmath>
+
+#include "shot_cache.hpp"
+
+
+ShotCache::ShotCache(int capacity, float position_step, float shot_step) :
+	inverse_position_step(1.f / position_step),
+	inverse_shot_step(1.f / shot_step)
+{
+	assert(capacity > 0);
+	entries.resize(capacity);
+
+	int num_buckets = 1;
+	while (num_buckets < capacity) {
+		num_buckets *= 2;
+	}
+	buckets.resize(num_buckets);
+	clear();
+}
+
+
+bool ShotCache::Key::operator==(Key const& other) const
+{
+	return table == other.table && shot_x == other.shot_x && shot_y == other.shot_y && recent_contacts == other.recent_contacts;
+}
+
+
+ShotCache::Key ShotCache::make_key(Physics::State const& state, Vector2 shot) const
+{
+	Key key;
+	key.table = PositionKey::make(state, inverse_position_step);
+	key.recent_contacts = 0;
+	for (int i = 0; i < 7; i++) {
+		for (int j = i + 1; j < 7; j++) {
+			if (!state.scored[i] && !state.scored[j] && state.last_collision[i][j] == 0) {
+				key.recent_contacts |= 1ull << (i * 7 + j);
+			}
+		}
+	}
+	key.shot_x = int32_t(std::lround(shot.x * inverse_shot_step));
+	key.shot_y = int32_t(std::lround(shot.y * inverse_shot_step));
+	return key;
+}
+
+
+uint64_t ShotCache::hash_key(Key const& key)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](int32_t value) {
+		hash = (hash ^ uint32_t(value)) * 1099511628211ull;
+	};
+	for (int32_t value : key.table) {
+		mix(value);
+	}
+	mix(key.shot_x);
+	mix(key.shot_y);
+	mix(int32_t(key.recent_contacts));
+	mix(int32_t(key.recent_contacts >> 32));
+	// FNV leaves low bits weak, buckets are taken from them
+	hash ^= hash >> 29;
+	hash *= 0xbf58476d1ce4e5b9ull;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+
+int ShotCache::lookup(Key const& key, uint64_t hash) const
+{
+	int index = buckets[hash & (buckets.size() - 1)];
+	while (index >= 0) {
+		Entry const& entry = entries[index];
+		if (entry.hash == hash && entry.key == key) {
+			return index;
+		}
+		index = entry.next_in_bucket;
+	}
+	return -1;
+}
+
+
+void ShotCache::unlink_bucket(int index)
+{
+	int* link = &buckets[entries[index].hash & (buckets.size() - 1)];
+	while (*link != index) {
+		assert(*link >= 0);
+		link = &entries[*link].next_in_bucket;
+	}
+	*link = entries[index].next_in_bucket;
+}
+
+
+void ShotCache::unlink_lru(int index)
+{
+	Entry& entry = entries[index];
+	if (entry.newer >= 0) {
+		entries[entry.newer].older = entry.older;
+	}
+	else {
+		newest = entry.older;
+	}
+	if (entry.older >= 0) {
+		entries[entry.older].newer = entry.newer;
+	}
+	else {
+		oldest = entry.newer;
+	}
+}
+
+
+void ShotCache::push_front(int index)
+{
+	Entry& entry = entries[index];
+	entry.newer = -1;
+	entry.older = newest;
+	if (newest >= 0) {
+		entries[newest].newer = index;
+	}
+	newest = index;
+	if (oldest < 0) {
+		oldest = index;
+	}
+}
+
+
+int ShotCache::insert(Key const& key, uint64_t hash)
+{
+	int index;
+	if (used < int(entries.size())) {
+		index = used++;
+	}
+	else {
+		index = oldest;
+		unlink_lru(index);
+		unlink_bucket(index);
+	}
+
+	Entry& entry = entries[index];
+	entry.key = key;
+	entry.hash = hash;
+	int& bucket = buckets[hash & (buckets.size() - 1)];
+	entry.next_in_bucket = bucket;
+	bucket = index;
+	push_front(index);
+	return index;
+}
+
+
+ShotCache::Outcome const& ShotCache::evaluate(Physics::State const& state, Vector2 shot, float dt, int max_steps)
+{
+	const Key key = make_key(state, shot);
+	const uint64_t hash = hash_key(key);
+
+	int index = lookup(key, hash);
+	if (index >= 0) {
+		hit_count++;
+		unlink_lru(index);
+		push_front(index);
+		return entries[index].outcome;
+	}
+
+	miss_count++;
+	Physics::State shot_state = state;
+	shot_state.speeds.fill(Vector2(0, 0));
+	shot_state.speeds[0] = shot;
+
+	Outcome outcome;
+	outcome.steps = Physics::simulate_to_rest(shot_state, dt, max_steps);
+	outcome.positions = shot_state.positions;
+	outcome.scored = shot_state.scored;
+
+	index = insert(key, hash);
+	entries[index].outcome = outcome;
+	return entries[index].outcome;
+}
+
+
+ShotCache::Outcome const* ShotCache::find(Physics::State const& state, Vector2 shot)
+{
+	const Key key = make_key(state, shot);
+	const int index = lookup(key, hash_key(key));
+	if (index < 0) {
+		return nullptr;
+	}
+	unlink_lru(index);
+	push_front(index);
+	return &entries[index].outcome;
+}
+
+
+int ShotCache::hits() const
+{
+	return hit_count;
+}
+
+
+int ShotCache::misses() const
+{
+	return miss_count;
+}
+
+
+void ShotCache::clear()
+{
+	for (int& bucket : buckets) {
+		bucket = -1;
+	}
+	used = 0;
+	newest = -1;
+	oldest = -1;
+	hit_count = 0;
+	miss_count = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "vector2.hpp"
+#include "physics.hpp"
+#include "position_key.hpp"
+
+
+//-------------------------------------------------------
+//	Memo cache of simulated shots
+//-------------------------------------------------------
+
+// Table states and shots are quantized, so identical and near-identical positions
+// share one entry, as long as the same pairs of balls have just touched. Memory is allocated once, the least recently used entry is evicted when full.
+class ShotCache
+{
+public:
+	struct Outcome
+	{
+		std::array<Vector2, 7> positions;
+		std::array<bool, 7> scored;
+		int steps = 0;
+	};
+
+	ShotCache(int capacity, float position_step = 0.01f, float shot_step = 0.01f);
+	ShotCache(ShotCache const&) = delete;
+
+	// returns the cached outcome, or simulates the shot applied to the cue ball of a resting state and stores it.
+	// The reference is valid until the next evaluate call.
+	Outcome const& evaluate(Physics::State const& state, Vector2 shot, float dt, int max_steps);
+
+	// returns nullptr on a miss
+	Outcome const* find(Physics::State const& state, Vector2 shot);
+
+	int hits() const;
+	int misses() const;
+	void clear();
+
+private:
+	struct Key
+	{
+		PositionKey::Key table;
+		int32_t shot_x;
+		int32_t shot_y;
+		// pairs that touched in the last step skip their next contact test, bit i * 7 + j for i < j
+		uint64_t recent_contacts;
+
+		bool operator==(Key const& other) const;
+	};
+
+	struct Entry
+	{
+		Key key;
+		uint64_t hash;
+		Outcome outcome;
+		int next_in_bucket;
+		// LRU list, head is the most recently used
+		int newer;
+		int older;
+	};
+
+	Key make_key(Physics::State const& state, Vector2 shot) const;
+	static uint64_t hash_key(Key const& key);
+
+	int lookup(Key const& key, uint64_t hash) const;
+	int insert(Key const& key, uint64_t hash);
+	void unlink_bucket(int index);
+	void unlink_lru(int index);
+	void push_front(int index);
+
+	float const inverse_position_step;
+	float const inverse_shot_step;
+
+	std::vector<Entry> entries;
+	std::vector<int> buckets;
+	int used = 0;
+	int newest = -1;
+	int oldest = -1;
+	int hit_count = 0;
+	int miss_count = 0;
+};
@@ -0,0 +1,93 @@
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "table_sdf.hpp"
+
+
+namespace
+{
+	float bilinear(float v00, float v10, float v01, float v11, float fx, float fy)
+	{
+		const float top = v00 + (v10 - v00) * fx;
+		const float bottom = v01 + (v11 - v01) * fx;
+		return top + (bottom - top) * fy;
+	}
+}
+
+
+void DistanceField::bake(Vector2 min, Vector2 max, float cellSize, std::function< float(Vector2) > const& distance)
+{
+	assert(cellSize > 0.f && max.x > min.x && max.y > min.y);
+
+	origin = min;
+	inverseCellSize = 1.f / cellSize;
+	columns = int(std::ceil((max.x - min.x) * inverseCellSize)) + 1;
+	rows = int(std::ceil((max.y - min.y) * inverseCellSize)) + 1;
+	cells.resize(size_t(columns) * rows);
+
+	// gradient is taken from the exact function, so it stays sharp where the grid is coarse
+	const float h = 0.25f * cellSize;
+	for (int row = 0; row < rows; row++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			const Vector2 p = origin + Vector2(float(column), float(row)) * cellSize;
+			Cell& cell = cells[size_t(row) * columns + column];
+			cell.distance = distance(p);
+			cell.gradientX = (distance(p + Vector2(h, 0.f)) - distance(p - Vector2(h, 0.f))) / (2.f * h);
+			cell.gradientY = (distance(p + Vector2(0.f, h)) - distance(p - Vector2(0.f, h))) / (2.f * h);
+		}
+	}
+}
+
+
+bool DistanceField::isBaked() const
+{
+	return !cells.empty();
+}
+
+
+void DistanceField::locate(Vector2 point, int& index, float& fx, float& fy) const
+{
+	assert(isBaked());
+
+	const float gx = std::min(std::max((point.x - origin.x) * inverseCellSize, 0.f), float(columns - 1));
+	const float gy = std::min(std::max((point.y - origin.y) * inverseCellSize, 0.f), float(rows - 1));
+	const int column = std::min(int(gx), columns - 2);
+	const int row = std::min(int(gy), rows - 2);
+
+	index = row * columns + column;
+	fx = gx - float(column);
+	fy = gy - float(row);
+}
+
+
+DistanceField::Sample DistanceField::sample(Vector2 point) const
+{
+	int index;
+	float fx, fy;
+	locate(point, index, fx, fy);
+
+	Cell const& c00 = cells[index];
+	Cell const& c10 = cells[index + 1];
+	Cell const& c01 = cells[index + columns];
+	Cell const& c11 = cells[index + columns + 1];
+
+	Sample result;
+	result.distance = bilinear(c00.distance, c10.distance, c01.distance, c11.distance, fx, fy);
+	result.gradient = Vector2(bilinear(c00.gradientX, c10.gradientX, c01.gradientX, c11.gradientX, fx, fy),
+							  bilinear(c00.gradientY, c10.gradientY, c01.gradientY, c11.gradientY, fx, fy));
+	return result;
+}
+
+
+float DistanceField::distance(Vector2 point) const
+{
+	int index;
+	float fx, fy;
+	locate(point, index, fx, fy);
+
+	return bilinear(cells[index].distance, cells[index + 1].distance,
+					cells[index + columns].distance, cells[index + columns + 1].distance, fx, fy);
+}
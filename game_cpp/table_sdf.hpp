@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "vector2.hpp"
+
+
+//-------------------------------------------------------
+//	Signed distance field baked on a regular grid
+//-------------------------------------------------------
+
+// Any table shape is described by a distance function once, at bake time.
+// Afterwards a lookup is a bilinear blend of four cells, whatever the shape was.
+class DistanceField
+{
+public:
+	struct Sample
+	{
+		float distance = 0.f;
+		// direction in which the distance grows, not normalized between cells
+		Vector2 gradient;
+	};
+
+	DistanceField() = default;
+	DistanceField(DistanceField const&) = delete;
+
+	// samples distance on a grid of cellSize steps covering [min, max]
+	void bake(Vector2 min, Vector2 max, float cellSize, std::function< float(Vector2) > const& distance);
+	bool isBaked() const;
+
+	// points outside the baked area get the value of the nearest border cell
+	Sample sample(Vector2 point) const;
+	float distance(Vector2 point) const;
+
+private:
+	struct Cell
+	{
+		float distance;
+		float gradientX;
+		float gradientY;
+	};
+
+	void locate(Vector2 point, int& index, float& fx, float& fy) const;
+
+	Vector2 origin;
+	float inverseCellSize = 0.f;
+	int columns = 0;
+	int rows = 0;
+	std::vector< Cell > cells;
+};
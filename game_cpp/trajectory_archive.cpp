@@ -0,0 +1,710 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#include "trajectory_archive.hpp"
+
+
+namespace
+{
+	char const magic[4] = { 'M', 'B', 'T', 'A' };
+	char const block_magic[4] = { 'M', 'B', 'T', 'B' };
+	uint32_t const version = 2;
+
+	// blocks end at the first event after min_block_frames, or at max_block_frames without one
+	constexpr uint32_t min_block_frames = 120;
+	constexpr uint32_t max_block_frames = 1200;
+	// a frame adds at most a two byte run token and a keyframe of a tag and four five byte varints to a ball column,
+	// and less to the time column, so block buffers never grow past this
+	constexpr size_t max_frame_bytes = 24;
+	constexpr size_t column_capacity = max_block_frames * max_frame_bytes;
+
+	// token tags of a ball column, the token value is the frame count of a run
+	enum Tag : uint32_t
+	{
+		// frames where the position moved by the same amount as the frame before
+		tag_steady = 0,
+		// one frame, the second difference of x and y follows
+		tag_delta = 1,
+		// one frame, absolute x, y then the difference from the previous frame follow
+		tag_keyframe = 2,
+		// frames off the table
+		tag_absent = 3
+	};
+
+	// time column tokens: a run of frames with the last step length, or one frame with a new length that follows
+	enum TimeTag : uint32_t
+	{
+		time_same = 0,
+		time_new = 1
+	};
+
+	void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(uint8_t(value));
+	}
+
+	uint32_t zigzag(int32_t value) {
+		return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+	}
+
+	int32_t unzigzag(uint32_t value) {
+		return int32_t(value >> 1) ^ -int32_t(value & 1);
+	}
+
+	// reads from a column without going past its end
+	struct Cursor
+	{
+		uint8_t const* at;
+		uint8_t const* end;
+
+		bool get(uint64_t& value) {
+			value = 0;
+			for (int shift = 0; shift < 64 && at < end; shift += 7) {
+				const uint8_t byte = *at++;
+				value |= uint64_t(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool get_signed(int32_t& value) {
+			uint64_t raw;
+			if (!get(raw) || raw > UINT32_MAX) {
+				return false;
+			}
+			value = unzigzag(uint32_t(raw));
+			return true;
+		}
+	};
+
+	uint64_t to_microseconds(float seconds) {
+		return uint64_t(std::llround(double(seconds) * 1e6));
+	}
+}
+
+
+//-------------------------------------------------------
+//	Reader
+//-------------------------------------------------------
+
+bool TrajectoryArchive::open(char const* path)
+{
+	close();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	if (file.size() < sizeof(Header)) {
+		close();
+		return false;
+	}
+	Header const* candidate = reinterpret_cast<Header const*>(file.data());
+	if (std::memcmp(candidate->magic, magic, sizeof(magic)) || candidate->version != version || !(candidate->position_step > 0.f)) {
+		close();
+		return false;
+	}
+	header = candidate;
+
+	if (!read_index() && !scan_blocks()) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+
+bool TrajectoryArchive::read_index()
+{
+	if (file.size() < sizeof(Header) + sizeof(Footer)) {
+		return false;
+	}
+	Footer footer;
+	std::memcpy(&footer, file.data() + file.size() - sizeof(Footer), sizeof(Footer));
+	const uint64_t index_end = file.size() - sizeof(Footer);
+	if (std::memcmp(footer.magic, magic, sizeof(magic)) || footer.index_offset < sizeof(Header) || footer.index_offset > index_end ||
+		footer.index_offset % alignof(Block)) {
+		return false;
+	}
+	// a 32 bit count of 56 byte entries can't overflow 64 bits
+	if (uint64_t(footer.block_count) * sizeof(Block) != index_end - footer.index_offset) {
+		return false;
+	}
+
+	Block const* candidates = reinterpret_cast<Block const*>(file.data() + footer.index_offset);
+	if (!check_index(candidates, footer.block_count, footer.index_offset, footer.frame_count) ||
+		(footer.block_count && footer.duration < candidates[footer.block_count - 1].start_time)) {
+		return false;
+	}
+	blocks = candidates;
+	block_count = footer.block_count;
+	recorded_frames = footer.frame_count;
+	duration_microseconds = footer.duration;
+	data_end = footer.index_offset;
+	return true;
+}
+
+
+bool TrajectoryArchive::scan_blocks()
+{
+	// stops at the first block that isn't complete, the rest of the file was being written
+	scanned.clear();
+	uint64_t at = sizeof(Header);
+	uint32_t total_frames = 0;
+	while (file.size() - at >= sizeof(BlockHeader)) {
+		BlockHeader candidate;
+		std::memcpy(&candidate, file.data() + at, sizeof(BlockHeader));
+		Block const& block = candidate.block;
+		if (std::memcmp(candidate.magic, block_magic, sizeof(block_magic)) || block.offset != at + sizeof(BlockHeader) ||
+			block.first_frame != total_frames || block.frame_count == 0 || block.frame_count > uint32_t(INT_MAX) - total_frames) {
+			break;
+		}
+		uint64_t size = 0;
+		for (uint32_t column_size : block.column_sizes) {
+			size += column_size;
+		}
+		if (size > file.size() - block.offset) {
+			break;
+		}
+		scanned.push_back(block);
+		total_frames += block.frame_count;
+		at = block.offset + size;
+	}
+	if (!check_index(scanned.data(), uint32_t(scanned.size()), at, total_frames)) {
+		return false;
+	}
+
+	blocks = scanned.data();
+	block_count = uint32_t(scanned.size());
+	rebuilt = true;
+	recorded_frames = total_frames;
+	data_end = at;
+	duration_microseconds = 0;
+	// the duration was in the footer, it's the time of the last frame
+	Frame last;
+	while (recorded_frames > 0 && read(int(recorded_frames) - 1, 1, &last) != 1) {
+		// the last block is damaged, only its header got written
+		block_count--;
+		recorded_frames = block_count ? blocks[block_count - 1].first_frame + blocks[block_count - 1].frame_count : 0;
+	}
+	if (recorded_frames > 0) {
+		duration_microseconds = uint64_t(std::llround(last.time * 1e6));
+	}
+	return true;
+}
+
+
+// Blocks must cover frames 0 to total_frames in order, start no earlier than the previous one, and lie one after
+// the other between the header and end without overlapping. Sizes are compared by subtraction, nothing wraps.
+bool TrajectoryArchive::check_index(Block const* candidates, uint32_t count, uint64_t end, uint32_t total_frames) const
+{
+	if (total_frames > uint32_t(INT_MAX)) {
+		return false;
+	}
+	uint64_t next_offset = sizeof(Header);
+	uint32_t next_frame = 0;
+	uint64_t start_time = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		Block const& block = candidates[i];
+		if (block.first_frame != next_frame || block.frame_count == 0 || block.frame_count > total_frames - next_frame ||
+			block.start_time < start_time) {
+			return false;
+		}
+		if (block.offset > end || block.offset < next_offset || block.offset - next_offset < sizeof(BlockHeader)) {
+			return false;
+		}
+		uint64_t size = 0;
+		for (uint32_t column_size : block.column_sizes) {
+			size += column_size;
+		}
+		if (size > end - block.offset) {
+			return false;
+		}
+		next_offset = block.offset + size;
+		next_frame += block.frame_count;
+		start_time = block.start_time;
+	}
+	return next_frame == total_frames;
+}
+
+
+void TrajectoryArchive::close()
+{
+	file.close();
+	header = nullptr;
+	blocks = nullptr;
+	block_count = 0;
+	recorded_frames = 0;
+	duration_microseconds = 0;
+	data_end = 0;
+	rebuilt = false;
+	scanned.clear();
+}
+
+
+bool TrajectoryArchive::is_open() const
+{
+	return header != nullptr;
+}
+
+
+bool TrajectoryArchive::recovered() const
+{
+	return rebuilt;
+}
+
+
+int TrajectoryArchive::frame_count() const
+{
+	return int(recorded_frames);
+}
+
+
+double TrajectoryArchive::duration() const
+{
+	return duration_microseconds * 1e-6;
+}
+
+
+TrajectoryArchive::Block const* TrajectoryArchive::find_block(int frame) const
+{
+	Block const* last = blocks + block_count;
+	Block const* block = std::upper_bound(blocks, last, uint32_t(frame), [](uint32_t f, Block const& b) { return f < b.first_frame; });
+	return block == blocks ? nullptr : block - 1;
+}
+
+
+int TrajectoryArchive::frame_at(double time) const
+{
+	if (block_count == 0) {
+		return 0;
+	}
+	const uint64_t microseconds = time <= 0.0 ? 0 : uint64_t(std::llround(time * 1e6));
+	Block const* last = blocks + block_count;
+	Block const* block = std::upper_bound(blocks, last, microseconds, [](uint64_t t, Block const& b) { return t < b.start_time; });
+	if (block == blocks) {
+		return 0;
+	}
+	block--;
+
+	// only the time column of the block is decoded
+	Cursor cursor = { file.data() + block->offset, file.data() + block->offset + block->column_sizes[0] };
+	uint64_t now = block->start_time;
+	uint64_t dt = 0;
+	uint32_t frame = 0;
+	// the block's first step may end after time
+	int found = std::max(int(block->first_frame) - 1, 0);
+	while (frame < block->frame_count) {
+		uint64_t token;
+		if (!cursor.get(token)) {
+			break;
+		}
+		uint64_t run = token >> 1;
+		if ((token & 1) == time_new) {
+			if (!cursor.get(dt)) {
+				break;
+			}
+			run = 1;
+		}
+		for (; run > 0 && frame < block->frame_count; run--, frame++) {
+			now += dt;
+			if (now > microseconds) {
+				return found;
+			}
+			found = int(block->first_frame + frame);
+		}
+	}
+	return found;
+}
+
+
+bool TrajectoryArchive::decode_block(Block const& block, int first, int count, Frame* frames) const
+{
+	// frame i of the block goes to frames[shift + i], the frames before first have a negative index and are skipped
+	const int shift = int(block.first_frame) - first;
+	const int end = std::min(first + count, int(block.first_frame + block.frame_count)) - int(block.first_frame);
+	uint8_t const* column = file.data() + block.offset;
+
+	{
+		Cursor cursor = { column, column + block.column_sizes[0] };
+		uint64_t now = block.start_time;
+		uint64_t dt = 0;
+		int frame = 0;
+		while (frame < end) {
+			uint64_t token;
+			if (!cursor.get(token)) {
+				return false;
+			}
+			uint64_t run = token >> 1;
+			if ((token & 1) == time_new) {
+				if (!cursor.get(dt)) {
+					return false;
+				}
+				run = 1;
+			}
+			for (; run > 0 && frame < end; run--, frame++) {
+				now += dt;
+				const int i = shift + frame;
+				if (i >= 0 && i < count) {
+					frames[i].time = now * 1e-6;
+				}
+			}
+		}
+		column += block.column_sizes[0];
+	}
+
+	const float step = header->position_step;
+	for (int ball = 0; ball < 7; ball++) {
+		Cursor cursor = { column, column + block.column_sizes[ball + 1] };
+		column += block.column_sizes[ball + 1];
+		bool present = false;
+		int32_t x = 0, y = 0, dx = 0, dy = 0;
+		int frame = 0;
+		while (frame < end) {
+			uint64_t token;
+			if (!cursor.get(token)) {
+				return false;
+			}
+			uint64_t run = 1;
+			switch (token & 3) {
+				case tag_steady:
+				case tag_absent:
+					run = token >> 2;
+					present = (token & 3) == tag_steady;
+					break;
+				case tag_delta: {
+					int32_t ddx, ddy;
+					if (!cursor.get_signed(ddx) || !cursor.get_signed(ddy)) {
+						return false;
+					}
+					dx += ddx;
+					dy += ddy;
+					present = true;
+					break;
+				}
+				case tag_keyframe:
+					if (!cursor.get_signed(x) || !cursor.get_signed(y) || !cursor.get_signed(dx) || !cursor.get_signed(dy)) {
+						return false;
+					}
+					// the position is absolute, undo the step applied below
+					x -= dx;
+					y -= dy;
+					present = true;
+					break;
+			}
+			for (; run > 0 && frame < end; run--, frame++) {
+				if (present) {
+					x += dx;
+					y += dy;
+				}
+				const int i = shift + frame;
+				if (i >= 0 && i < count) {
+					frames[i].positions[ball] = Vector2(x * step, y * step);
+					frames[i].scored[ball] = !present;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+
+int TrajectoryArchive::read(int first, int count, Frame* frames) const
+{
+	if (!header || first < 0 || count <= 0 || first >= int(recorded_frames)) {
+		return 0;
+	}
+	count = std::min(count, int(recorded_frames) - first);
+
+	int decoded = 0;
+	Block const* block = find_block(first);
+	Block const* last = blocks + block_count;
+	while (block && block != last && decoded < count) {
+		if (block->first_frame != uint32_t(first + decoded) && decoded > 0) {
+			break;
+		}
+		if (!decode_block(*block, first, count, frames)) {
+			break;
+		}
+		decoded = std::min(int(block->first_frame + block->frame_count) - first, count);
+		block++;
+	}
+	return decoded;
+}
+
+
+//-------------------------------------------------------
+//	Writer
+//-------------------------------------------------------
+
+TrajectoryArchive::Writer::~Writer()
+{
+	close();
+}
+
+
+bool TrajectoryArchive::Writer::open(char const* path, float position_step)
+{
+	close();
+	file = std::fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+
+	Header out_header = {};
+	std::memcpy(out_header.magic, magic, sizeof(magic));
+	out_header.version = version;
+	out_header.position_step = position_step;
+	failed = std::fwrite(&out_header, sizeof(out_header), 1, file) != 1;
+	offset = sizeof(out_header);
+	index.clear();
+	index.reserve(max_blocks);
+
+	this->position_step = position_step;
+	recording = true;
+	time = 0;
+	frames = 0;
+	dropped = 0;
+	block_time = 0;
+	block_frames = 0;
+	last_dt = 0;
+	pending_times = 0;
+	tracks = {};
+	for (Slot& slot : ring) {
+		for (std::vector<uint8_t>& column : slot.columns) {
+			column.clear();
+			column.reserve(column_capacity);
+		}
+	}
+
+	produced.store(0);
+	consumed.store(0);
+	writer_quit = false;
+	writer = std::thread(&Writer::writer_loop, this);
+	return true;
+}
+
+
+bool TrajectoryArchive::Writer::close()
+{
+	if (!file) {
+		return false;
+	}
+	if (recording) {
+		end_block();
+		recording = false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(writer_mutex);
+		writer_quit = true;
+	}
+	writer_wake_up.notify_one();
+	writer.join();
+
+	// the index is used in place, so it starts aligned
+	const uint8_t padding[alignof(Block)] = {};
+	const size_t padding_size = size_t((alignof(Block) - offset % alignof(Block)) % alignof(Block));
+	failed = failed || (padding_size && std::fwrite(padding, 1, padding_size, file) != padding_size);
+	offset += padding_size;
+
+	Footer out_footer = {};
+	out_footer.index_offset = offset;
+	out_footer.duration = index.empty() ? 0 : time;
+	out_footer.block_count = uint32_t(index.size());
+	out_footer.frame_count = index.empty() ? 0 : index.back().first_frame + index.back().frame_count;
+	std::memcpy(out_footer.magic, magic, sizeof(magic));
+	bool ok = !failed;
+	ok = ok && (index.empty() || std::fwrite(index.data(), sizeof(Block), index.size(), file) == index.size());
+	ok = ok && std::fwrite(&out_footer, sizeof(out_footer), 1, file) == 1;
+	ok = std::fclose(file) == 0 && ok;
+	file = nullptr;
+	return ok;
+}
+
+
+bool TrajectoryArchive::Writer::is_open() const
+{
+	return file != nullptr;
+}
+
+
+uint32_t TrajectoryArchive::Writer::dropped_frames() const
+{
+	return dropped;
+}
+
+
+void TrajectoryArchive::Writer::add_frame(Physics::State const& state, float dt, uint32_t event_mask)
+{
+	if (!recording) {
+		return;
+	}
+	if (block_frames >= max_block_frames || (block_frames >= min_block_frames && event_mask)) {
+		end_block();
+	}
+
+	const uint32_t step_time = uint32_t(to_microseconds(dt));
+	if (block_frames == 0) {
+		const uint32_t block = produced.load(std::memory_order_relaxed);
+		if (block == max_blocks || block - consumed.load(std::memory_order_acquire) == ring_size) {
+			// the next block starts with keyframes whose speed isn't taken across the gap
+			for (Track& track : tracks) {
+				track.present = false;
+			}
+			time += step_time;
+			dropped++;
+			return;
+		}
+		block_time = time;
+	}
+	std::array<std::vector<uint8_t>, 8>& columns = ring[produced.load(std::memory_order_relaxed) % ring_size].columns;
+
+	if (step_time == last_dt && block_frames > 0) {
+		pending_times++;
+	}
+	else {
+		if (pending_times) {
+			put_varint(columns[0], uint64_t(pending_times) << 1 | time_same);
+			pending_times = 0;
+		}
+		put_varint(columns[0], time_new);
+		put_varint(columns[0], step_time);
+		last_dt = step_time;
+	}
+	time += step_time;
+
+	const float inverse_step = 1.f / position_step;
+	for (int ball = 0; ball < 7; ball++) {
+		Track& track = tracks[ball];
+		std::vector<uint8_t>& column = columns[ball + 1];
+		auto flush_run = [&track, &column]() {
+			if (track.pending) {
+				put_varint(column, uint64_t(track.pending) << 2 | track.pending_tag);
+				track.pending = 0;
+			}
+		};
+
+		if (state.scored[ball]) {
+			if (track.pending_tag != tag_absent) {
+				flush_run();
+			}
+			track.pending_tag = tag_absent;
+			track.pending++;
+			track.present = false;
+			continue;
+		}
+
+		const int32_t x = int32_t(std::lround(state.positions[ball].x * inverse_step));
+		const int32_t y = int32_t(std::lround(state.positions[ball].y * inverse_step));
+		const int32_t dx = track.present ? x - track.x : 0;
+		const int32_t dy = track.present ? y - track.y : 0;
+		if (track.keyframe || !track.present || ((event_mask >> ball) & 1)) {
+			flush_run();
+			put_varint(column, tag_keyframe);
+			put_varint(column, zigzag(x));
+			put_varint(column, zigzag(y));
+			put_varint(column, zigzag(dx));
+			put_varint(column, zigzag(dy));
+			track.keyframe = false;
+		}
+		else if (dx == track.dx && dy == track.dy) {
+			if (track.pending_tag != tag_steady) {
+				flush_run();
+			}
+			track.pending_tag = tag_steady;
+			track.pending++;
+		}
+		else {
+			flush_run();
+			put_varint(column, tag_delta);
+			put_varint(column, zigzag(dx - track.dx));
+			put_varint(column, zigzag(dy - track.dy));
+		}
+		track.present = true;
+		track.x = x;
+		track.y = y;
+		track.dx = dx;
+		track.dy = dy;
+	}
+
+	block_frames++;
+	frames++;
+}
+
+
+// completes the block being encoded and hands it to the writer thread
+void TrajectoryArchive::Writer::end_block()
+{
+	if (block_frames == 0) {
+		return;
+	}
+	const uint32_t block = produced.load(std::memory_order_relaxed);
+	Slot& slot = ring[block % ring_size];
+	if (pending_times) {
+		put_varint(slot.columns[0], uint64_t(pending_times) << 1 | time_same);
+		pending_times = 0;
+	}
+	for (int ball = 0; ball < 7; ball++) {
+		Track& track = tracks[ball];
+		if (track.pending) {
+			put_varint(slot.columns[ball + 1], uint64_t(track.pending) << 2 | track.pending_tag);
+			track.pending = 0;
+		}
+		// the next block must decode without this one
+		track.keyframe = true;
+	}
+
+	slot.block = {};
+	slot.block.start_time = block_time;
+	slot.block.first_frame = frames - block_frames;
+	slot.block.frame_count = block_frames;
+	for (size_t i = 0; i < slot.columns.size(); i++) {
+		assert(slot.columns[i].size() <= column_capacity);
+		slot.block.column_sizes[i] = uint32_t(slot.columns[i].size());
+	}
+	block_frames = 0;
+
+	produced.store(block + 1, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(writer_mutex);
+	}
+	writer_wake_up.notify_one();
+}
+
+
+void TrajectoryArchive::Writer::writer_loop()
+{
+	while (true) {
+		const uint32_t block = consumed.load(std::memory_order_relaxed);
+		if (block == produced.load(std::memory_order_acquire)) {
+			std::unique_lock<std::mutex> lock(writer_mutex);
+			if (writer_quit) {
+				break;
+			}
+			writer_wake_up.wait(lock, [this, block] { return writer_quit || block != produced.load(std::memory_order_acquire); });
+			continue;
+		}
+
+		Slot& slot = ring[block % ring_size];
+		BlockHeader out_header = {};
+		std::memcpy(out_header.magic, block_magic, sizeof(block_magic));
+		out_header.block = slot.block;
+		out_header.block.offset = offset + sizeof(BlockHeader);
+		failed = failed || std::fwrite(&out_header, sizeof(out_header), 1, file) != 1;
+		offset += sizeof(BlockHeader);
+		for (std::vector<uint8_t>& column : slot.columns) {
+			failed = failed || (!column.empty() && std::fwrite(column.data(), 1, column.size(), file) != column.size());
+			offset += column.size();
+			column.clear();
+		}
+		index.push_back(out_header.block);
+		consumed.store(block + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+
+#include "../framework/mapped_file.hpp"
+
+#include "vector2.hpp"
+#include "physics.hpp"
+
+
+//-------------------------------------------------------
+//	Recorded ball trajectories
+//-------------------------------------------------------
+
+// The file is a header, blocks of frames, the block index and a footer pointing at the index. Every
+// block stores one column of frame times then one column per ball, each coded without the others.
+// Positions are quantized and each column is a stream of varint tokens: runs of frames where the ball
+// kept its speed, second differences of the position otherwise, keyframes with the absolute position
+// where an event changed the ball's path, and runs of frames off the table. Blocks start with keyframes
+// and are cut at events, the reader maps the file and decodes only the blocks covering the frames asked
+// for. Each block is preceded by a copy of its index entry, so a recording that was never closed can
+// still be read up to its last complete block.
+class TrajectoryArchive
+{
+public:
+	struct Frame
+	{
+		// seconds since the start of the recording, after this frame's step
+		double time = 0.0;
+		std::array<Vector2, 7> positions;
+		std::array<bool, 7> scored;
+	};
+
+	TrajectoryArchive() = default;
+	TrajectoryArchive(TrajectoryArchive const&) = delete;
+
+	// checks the header and the whole index, blocks are paged in when read.
+	// Without a valid footer the index is rebuilt from the block headers.
+	bool open(char const* path);
+	void close();
+	bool is_open() const;
+
+	// the footer was missing or damaged and the blocks were found by scanning the file
+	bool recovered() const;
+
+	int frame_count() const;
+	double duration() const;
+
+	// last frame at or before time, 0 before the first one
+	int frame_at(double time) const;
+
+	// decodes frames [first, first + count), returns how many were decoded; less only past the end or on corrupted data
+	int read(int first, int count, Frame* frames) const;
+
+
+private:
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		float position_step;
+		uint32_t reserved;
+	};
+
+	struct Block
+	{
+		// start of the columns, right after the block header
+		uint64_t offset;
+		// microseconds at the start of the block's first step
+		uint64_t start_time;
+		uint32_t first_frame;
+		uint32_t frame_count;
+		// the time column then the ball columns, stored back to back from offset
+		uint32_t column_sizes[8];
+	};
+
+	struct BlockHeader
+	{
+		char magic[4];
+		uint32_t reserved;
+		Block block;
+	};
+
+	struct Footer
+	{
+		uint64_t index_offset;
+		uint64_t duration;
+		uint32_t block_count;
+		uint32_t frame_count;
+		char magic[4];
+		uint32_t reserved;
+	};
+
+public:
+	// Streams frames to a file as blocks fill up. Blocks are encoded on the calling thread into a ring
+	// of buffers allocated on open, and a writer thread puts them in the file. If the writer falls behind,
+	// frames are dropped rather than the game stalled. A recording holds at most max_blocks blocks,
+	// over two hours at 60 steps per second; later frames are dropped.
+	class Writer
+	{
+	public:
+		static constexpr uint32_t max_blocks = 4096;
+
+		Writer() = default;
+		Writer(Writer const&) = delete;
+		~Writer();
+
+		bool open(char const* path, float position_step = 1.f / 1024);
+		// writes the last block and the index; without them the file is read by scanning its blocks
+		bool close();
+		bool is_open() const;
+
+		// appends the state after a step of dt; balls whose bit is set in event_mask get a keyframe
+		void add_frame(Physics::State const& state, float dt, uint32_t event_mask);
+
+		// frames not recorded since open, because the ring was full or the index reached max_blocks
+		uint32_t dropped_frames() const;
+
+	private:
+		static constexpr uint32_t ring_size = 4;
+
+		// encoder state of one ball across frames
+		struct Track
+		{
+			bool present = false;
+			bool keyframe = true;
+			int32_t x = 0, y = 0;
+			int32_t dx = 0, dy = 0;
+			// frames in the token not written yet, and its tag
+			uint32_t pending = 0;
+			uint32_t pending_tag = 0;
+		};
+
+		struct Slot
+		{
+			Block block;
+			std::array<std::vector<uint8_t>, 8> columns;
+		};
+
+		void end_block();
+		void writer_loop();
+
+		FILE* file = nullptr;
+		float position_step = 0.f;
+
+		// encoder, calling thread only
+		bool recording = false;
+		uint64_t time = 0;
+		uint32_t frames = 0;
+		uint32_t dropped = 0;
+		uint64_t block_time = 0;
+		uint32_t block_frames = 0;
+		uint32_t last_dt = 0;
+		uint32_t pending_times = 0;
+		std::array<Track, 7> tracks;
+
+		// single producer (encoder), single consumer (writer thread); the encoder fills ring[produced % ring_size]
+		std::array<Slot, ring_size> ring;
+		std::atomic<uint32_t> produced{ 0 };
+		std::atomic<uint32_t> consumed{ 0 };
+
+		std::thread writer;
+		std::mutex writer_mutex;
+		std::condition_variable writer_wake_up;
+		bool writer_quit = false;
+
+		// writer thread only until it's joined
+		bool failed = false;
+		uint64_t offset = 0;
+		std::vector<Block> index;
+	};
+
+private:
+	bool read_index();
+	bool scan_blocks();
+	bool check_index(Block const* candidates, uint32_t count, uint64_t end, uint32_t total_frames) const;
+	Block const* find_block(int frame) const;
+	bool decode_block(Block const& block, int first, int count, Frame* frames) const;
+
+	MappedFile file;
+	Header const* header = nullptr;
+	Block const* blocks = nullptr;
+	uint32_t block_count = 0;
+	uint32_t recorded_frames = 0;
+	uint64_t duration_microseconds = 0;
+	// end of the block data
+	uint64_t data_end = 0;
+	// index rebuilt by scanning, when the footer can't be used
+	bool rebuilt = false;
+	std::vector<Block> scanned;
+};
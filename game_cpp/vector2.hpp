@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cmath>
+
+
+//-------------------------------------------------------
+//	Basic Vector2 class
+//-------------------------------------------------------
+
+class Vector2
+{
+public:
+	float x = 0.f;
+	float y = 0.f;
+
+	constexpr Vector2() = default;
+	constexpr Vector2(float vx, float vy);
+	constexpr Vector2(Vector2 const& other) = default;
+	Vector2 operator+=(Vector2 const& other) {
+		x += other.x;
+		y += other.y;
+		return *this;
+	}
+	Vector2 operator+(Vector2 const& other) const {
+		Vector2 v = *this;
+		return v += other;
+	}
+	Vector2 operator-=(Vector2 const& other) {
+		x -= other.x;
+		y -= other.y;
+		return *this;
+	}
+	Vector2 operator-(Vector2 const& other) const {
+		Vector2 v = *this;
+		return v -= other;
+	}
+	Vector2 operator*=(float const& c) {
+		x *= c;
+		y *= c;
+		return *this;
+	}
+	Vector2 operator*(float const& c) const {
+		Vector2 v = *this;
+		return v *= c;
+	}
+	operator bool() const {
+		if (x == 0 && y == 0) {
+			return false;
+		}
+		return true;
+	}
+};
+inline float Abs(const Vector2& v) {
+	return sqrt(v.x * v.x + v.y * v.y);
+}
+inline float Dot(const Vector2& a, const Vector2& b) {
+	return a.x * b.x + a.y * b.y;
+}
+
+
+constexpr Vector2::Vector2(float vx, float vy) :
+	x(vx),
+	y(vy)
+{
+}
@@ -0,0 +1,459 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <vector>
+
+#include "../framework/jobs.hpp"
+
+#include "../game_cpp/params.hpp"
+#include "../game_cpp/physics.hpp"
+#include "../game_cpp/fixed_physics.hpp"
+#include "../game_cpp/physics_events.hpp"
+#include "../game_cpp/shot_cache.hpp"
+#include "../game_cpp/aiming.hpp"
+#include "../game_cpp/trajectory_archive.hpp"
+
+
+//-------------------------------------------------------
+//	checks of the game code that runs without a window
+//
+//	usage: game_tests
+//
+//	prints every failed check and returns the number of failures
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr float dt = 1.f / Params::System::targetFPS;
+	constexpr int maxSteps = 120 * Params::System::targetFPS;
+
+	int failures = 0;
+
+#define CHECK( condition ) \
+	do \
+	{ \
+		if ( !( condition ) ) \
+		{ \
+			std::fprintf( stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition ); \
+			failures++; \
+		} \
+	} while ( false )
+
+
+	void testShotCache()
+	{
+		Physics::State state;
+		Physics::reset( state );
+		const Vector2 shotA( 1.f, 0.f );
+		const Vector2 shotB( 0.f, 1.f );
+		const Vector2 shotC( -1.f, 0.f );
+
+		ShotCache cache( 2 );
+		CHECK( !cache.find( state, shotA ) );
+
+		ShotCache::Outcome const first = cache.evaluate( state, shotA, dt, maxSteps );
+		CHECK( cache.misses() == 1 && cache.hits() == 0 );
+		CHECK( first.steps > 0 );
+
+		// a shot within the quantization step shares the entry
+		ShotCache::Outcome const& again = cache.evaluate( state, shotA + Vector2( 0.001f, 0.f ), dt, maxSteps );
+		CHECK( cache.misses() == 1 && cache.hits() == 1 );
+		CHECK( again.steps == first.steps && again.positions[0].x == first.positions[0].x && again.positions[0].y == first.positions[0].y );
+
+		// B is now the least recently used, C takes its place
+		cache.evaluate( state, shotB, dt, maxSteps );
+		CHECK( cache.find( state, shotA ) );
+		cache.evaluate( state, shotC, dt, maxSteps );
+		CHECK( cache.misses() == 3 );
+		CHECK( !cache.find( state, shotB ) );
+		CHECK( cache.find( state, shotA ) && cache.find( state, shotC ) );
+
+		// balls that have just touched skip their next contact, the same positions are another entry
+		Physics::State touched = state;
+		touched.last_collision[1][2] = 0;
+		CHECK( !cache.find( touched, shotA ) );
+		cache.evaluate( touched, shotA, dt, maxSteps );
+		CHECK( cache.misses() == 4 );
+
+		cache.clear();
+		CHECK( !cache.find( state, shotA ) && cache.hits() == 0 && cache.misses() == 0 );
+	}
+
+
+	// the cue ball and ball 1 alone on the table
+	Physics::State twoBalls( Vector2 cue, Vector2 target )
+	{
+		Physics::State state;
+		Physics::reset( state );
+		for ( int i = 2; i < 7; i++ )
+			state.scored[i] = true;
+		state.positions[0] = cue;
+		state.positions[1] = target;
+		return state;
+	}
+
+
+	// pocket nearest to where a ball came to rest, scored balls stay where they were captured
+	int nearestPocket( Physics::State const& state, int ball )
+	{
+		int nearest = 0;
+		for ( int i = 1; i < 6; i++ )
+		{
+			if ( Abs( state.positions[ball] - Params::Table::pocketsPositions[i] ) < Abs( state.positions[ball] - Params::Table::pocketsPositions[nearest] ) )
+				nearest = i;
+		}
+		return nearest;
+	}
+
+
+	void testAiming()
+	{
+		// cue ball, target and the bottom side pocket in a line
+		const Physics::State straight = twoBalls( Vector2( 0.f, 0.f ), Vector2( 0.f, -2.f ) );
+		const Aiming::Solution straightShot = Aiming::solve( straight, 1, 1, dt, maxSteps );
+		CHECK( straightShot.pocketed );
+		CHECK( straightShot.simulations <= 24 );
+
+		// about 20 degrees of cut into the bottom right corner
+		const Physics::State cut = twoBalls( Vector2( -4.f, 0.f ), Vector2( 2.f, -1.f ) );
+		const Aiming::Solution cutShot = Aiming::solve( cut, 1, 2, dt, maxSteps );
+		CHECK( cutShot.pocketed );
+		CHECK( cutShot.simulations <= 24 );
+
+		Physics::State played = cut;
+		played.speeds[0] = cutShot.shot;
+		Physics::simulate_to_rest( played, dt, maxSteps );
+		CHECK( played.scored[1] && nearestPocket( played, 1 ) == 2 && !played.scored[0] );
+
+		// the top side pocket is behind the cue ball, shots at it put the target in the bottom one
+		const Aiming::Solution wrongPocket = Aiming::solve( straight, 1, 4, dt, maxSteps );
+		CHECK( !wrongPocket.pocketed );
+		Physics::State missed = straight;
+		missed.speeds[0] = wrongPocket.shot;
+		Physics::simulate_to_rest( missed, dt, maxSteps );
+		CHECK( missed.scored[1] && nearestPocket( missed, 1 ) == 1 );
+	}
+
+
+	void testJobDependencies()
+	{
+		Jobs::init( 3 );
+
+		// c waits for both a and b, each records its place in the order it ran
+		std::atomic< int > order{ 0 };
+		int ranA = -1, ranB = -1, ranC = -1;
+		auto a = [&]{ ranA = order.fetch_add( 1 ); };
+		auto b = [&]{ ranB = order.fetch_add( 1 ); };
+		auto c = [&]{ ranC = order.fetch_add( 1 ); };
+		Jobs::Job* jobA = Jobs::createJob( a );
+		Jobs::Job* jobB = Jobs::createJob( b );
+		Jobs::Job* jobC = Jobs::createJob( c );
+		Jobs::addDependency( jobC, jobA );
+		Jobs::addDependency( jobC, jobB );
+		Jobs::submit( jobC );
+		Jobs::submit( jobB );
+		Jobs::submit( jobA );
+		Jobs::wait( jobC );
+		CHECK( order.load() == 3 );
+		CHECK( ranC == 2 && ranA >= 0 && ranB >= 0 );
+
+		// every chunk of a parallel job finishes before its dependent starts
+		std::vector< int > values( 1000, 0 );
+		int sum = 0;
+		auto fill = [&]( int i ) { values[i] = i; };
+		auto add = [&]{ for ( int value : values ) sum += value; };
+		Jobs::Job* fillJob = Jobs::createParallelJob( 0, int( values.size() ), 16, fill );
+		Jobs::Job* addJob = Jobs::createJob( add );
+		Jobs::addDependency( addJob, fillJob );
+		Jobs::submit( addJob );
+		Jobs::submit( fillJob );
+		Jobs::wait( addJob );
+		CHECK( sum == 999 * 1000 / 2 );
+
+		Jobs::deinit();
+	}
+
+
+	// the same shots played to rest one after another, then spread over workers, must end bit for bit the same
+	void testParallelDeterminism()
+	{
+		constexpr int numShots = 64;
+		std::vector< Physics::State > serial( numShots );
+		uint32_t random = 12345;
+		for ( Physics::State& state : serial )
+		{
+			Physics::reset( state );
+			random = random * 1664525u + 1013904223u;
+			state.speeds[0].x = float( int( random >> 20 ) - 2048 ) / 512.f;
+			state.speeds[0].y = float( int( random >> 20 ) - 2048 ) / 1024.f;
+		}
+		std::vector< Physics::State > parallel = serial;
+
+		for ( Physics::State& state : serial )
+			Physics::simulate_to_rest( state, dt, maxSteps );
+
+		Jobs::init( 3 );
+		Jobs::parallelFor( 0, numShots, 2, [&]( int i ) { Physics::simulate_to_rest( parallel[i], dt, maxSteps ); } );
+		Jobs::deinit();
+
+		for ( int i = 0; i < numShots; i++ )
+		{
+			CHECK( std::memcmp( &serial[i].positions, &parallel[i].positions, sizeof( serial[i].positions ) ) == 0 );
+			CHECK( serial[i].scored == parallel[i].scored );
+		}
+	}
+
+
+	// first cushion the cue ball hits when rolled alone from the middle of the table, -1 if none
+	template< class Step >
+	int firstCushion( Vector2 speed, Step const& step )
+	{
+		Physics::State state = twoBalls( Vector2( 0.f, 0.f ), Vector2( 0.f, 0.f ) );
+		state.scored[1] = true;
+		state.speeds[0] = speed;
+		PhysicsEvents::Ring ring;
+		PhysicsEvents::Reader reader( ring );
+		std::array< bool, 7 > pocketed;
+		for ( int i = 0; i < maxSteps && Physics::is_moving( state ); i++ )
+		{
+			step( state, dt, pocketed, &ring );
+			PhysicsEvents::Event event;
+			while ( reader.next( event ) )
+			{
+				if ( event.type == PhysicsEvents::Type::wall && event.ball == 0 )
+					return event.other;
+			}
+		}
+		return -1;
+	}
+
+
+	void testPhysicsEvents()
+	{
+		// the float and the fixed point steps name the same cushions
+		auto floatStep = []( Physics::State& state, float dt, std::array< bool, 7 >& pocketed, PhysicsEvents::Ring* events ) { Physics::step( state, dt, pocketed, events ); };
+		auto fixedStep = []( Physics::State& state, float dt, std::array< bool, 7 >& pocketed, PhysicsEvents::Ring* events ) { FixedPhysics::step( state, dt, pocketed, events ); };
+		const struct { Vector2 speed; PhysicsEvents::Cushion cushion; } shots[] =
+		{
+			{ Vector2( 3.f, -10.f ), PhysicsEvents::Cushion::bottom },
+			{ Vector2( 10.f, 0.3f ), PhysicsEvents::Cushion::right },
+			{ Vector2( -3.f, 10.f ), PhysicsEvents::Cushion::top },
+			{ Vector2( -10.f, -0.3f ), PhysicsEvents::Cushion::left }
+		};
+		for ( auto const& shot : shots )
+		{
+			CHECK( firstCushion( shot.speed, floatStep ) == int( shot.cushion ) );
+			CHECK( firstCushion( shot.speed, fixedStep ) == int( shot.cushion ) );
+		}
+
+		// a reader more than capacity events behind keeps the newest ones and counts the others
+		PhysicsEvents::Ring ring;
+		PhysicsEvents::Reader reader( ring );
+		const int numEvents = PhysicsEvents::Ring::capacity + 5;
+		for ( int i = 0; i < numEvents; i++ )
+			ring.publish( PhysicsEvents::wall_event( 0, Vector2( 0.f, 0.f ), 0.f, float( i ), dt ) );
+		CHECK( ring.published() == uint64_t( numEvents ) );
+		PhysicsEvents::Event event;
+		int received = 0;
+		bool inOrder = true;
+		while ( reader.next( event ) )
+		{
+			inOrder = inOrder && event.impact_speed == float( 5 + received );
+			received++;
+		}
+		CHECK( received == int( PhysicsEvents::Ring::capacity ) && reader.dropped() == 5 && inOrder );
+	}
+
+
+	// FNV-1a over the bits of every final position, as physics_bench prints it
+	void addToChecksum( uint64_t& checksum, Physics::State const& state )
+	{
+		for ( Vector2 const& position : state.positions )
+		{
+			uint32_t bits[2];
+			std::memcpy( &bits[0], &position.x, sizeof( float ) );
+			std::memcpy( &bits[1], &position.y, sizeof( float ) );
+			for ( uint32_t word : bits )
+				for ( int byte = 0; byte < 4; byte++ )
+				{
+					checksum ^= ( word >> ( 8 * byte ) ) & 0xff;
+					checksum *= 1099511628211ull;
+				}
+		}
+	}
+
+
+	// the fixed point step gives the same bits on every compiler, platform and build configuration;
+	// the expected value is what physics_bench 500 prints for FixedPhysics
+	void testFixedPointChecksum()
+	{
+		Physics::State opening;
+		Physics::reset( opening );
+		uint64_t checksum = 14695981039346656037ull;
+		uint32_t random = 12345;
+		for ( int shot = 0; shot < 500; shot++ )
+		{
+			Physics::State state = opening;
+			random = random * 1664525u + 1013904223u;
+			state.speeds[0].x = float( int( random >> 20 ) - 2048 ) / 512.f;
+			random = random * 1664525u + 1013904223u;
+			state.speeds[0].y = float( int( random >> 20 ) - 2048 ) / 1024.f;
+			FixedPhysics::simulate_to_rest( state, dt, maxSteps );
+			addToChecksum( checksum, state );
+		}
+		CHECK( checksum == 0x4da8c723f88bf0c6ull );
+	}
+
+
+	bool sameFrame( TrajectoryArchive::Frame const& a, TrajectoryArchive::Frame const& b )
+	{
+		return a.time == b.time && a.scored == b.scored && std::memcmp( &a.positions, &b.positions, sizeof( a.positions ) ) == 0;
+	}
+
+
+	// copies the first size bytes of a file, as if the program writing it had stopped there
+	bool copyPrefix( const char* from, const char* to, long size )
+	{
+		std::vector< char > bytes( static_cast< size_t >( size ) );
+		FILE* in = std::fopen( from, "rb" );
+		if ( !in )
+			return false;
+		const bool read = std::fread( bytes.data(), 1, bytes.size(), in ) == bytes.size();
+		std::fclose( in );
+		FILE* out = std::fopen( to, "wb" );
+		if ( !out )
+			return false;
+		const bool written = std::fwrite( bytes.data(), 1, bytes.size(), out ) == bytes.size();
+		return std::fclose( out ) == 0 && read && written;
+	}
+
+
+	long fileSize( const char* path )
+	{
+		FILE* file = std::fopen( path, "rb" );
+		if ( !file )
+			return -1;
+		std::fseek( file, 0, SEEK_END );
+		const long size = std::ftell( file );
+		std::fclose( file );
+		return size;
+	}
+
+
+	void testTrajectoryArchive()
+	{
+		const char* path = "game_tests.mbta";
+		const char* cutPath = "game_tests_cut.mbta";
+		const float positionStep = 1.f / 1024;
+
+		// a break played with uneven frame times; one event cuts the first block, the others end at their size limit,
+		// so the four blocks always fit the writer's ring and no frame is dropped
+		constexpr int numFrames = 3000;
+		constexpr int eventFrame = 300;
+		std::vector< Physics::State > states;
+		std::vector< double > times;
+		Physics::State state;
+		Physics::reset( state );
+		state.speeds[0] = Vector2( 20.f, 0.5f );
+		double time = 0.0;
+
+		TrajectoryArchive::Writer writer;
+		CHECK( writer.open( path, positionStep ) );
+		for ( int frame = 0; frame < numFrames; frame++ )
+		{
+			const float frameTime = frame % 7 == 3 ? 1.5f * dt : dt;
+			std::array< bool, 7 > pocketed;
+			Physics::step( state, frameTime, pocketed );
+			writer.add_frame( state, frameTime, frame == eventFrame ? 1u : 0u );
+			states.push_back( state );
+			time += std::llround( double( frameTime ) * 1e6 ) * 1e-6;
+			times.push_back( time );
+		}
+		CHECK( writer.dropped_frames() == 0 );
+		CHECK( writer.close() );
+
+		TrajectoryArchive archive;
+		CHECK( archive.open( path ) );
+		CHECK( !archive.recovered() );
+		CHECK( archive.frame_count() == numFrames );
+
+		std::vector< TrajectoryArchive::Frame > frames( numFrames );
+		CHECK( archive.read( 0, numFrames, frames.data() ) == numFrames );
+		float maxError = 0.f;
+		bool scoredExact = true;
+		double maxTimeError = 0.0;
+		for ( int frame = 0; frame < numFrames; frame++ )
+		{
+			for ( int ball = 0; ball < 7; ball++ )
+			{
+				scoredExact = scoredExact && frames[frame].scored[ball] == states[frame].scored[ball];
+				if ( states[frame].scored[ball] )
+					continue;
+				const Vector2 error = frames[frame].positions[ball] - states[frame].positions[ball];
+				maxError = std::max( maxError, std::max( std::fabs( error.x ), std::fabs( error.y ) ) );
+			}
+			maxTimeError = std::max( maxTimeError, std::fabs( frames[frame].time - times[frame] ) );
+		}
+		CHECK( maxError <= positionStep );
+		CHECK( scoredExact );
+		CHECK( maxTimeError < 1e-9 );
+
+		// the last frame at or before a time, including the frames next to block boundaries
+		const int probes[] = { 0, 1, eventFrame - 1, eventFrame, eventFrame + 1, 1499, 1500, numFrames - 1 };
+		for ( int frame : probes )
+			CHECK( archive.frame_at( frames[frame].time ) == frame );
+		CHECK( archive.frame_at( -1.0 ) == 0 );
+		CHECK( archive.frame_at( 0.5 * ( frames[1000].time + frames[1001].time ) ) == 1000 );
+		CHECK( archive.frame_at( frames[numFrames - 1].time + 10.0 ) == numFrames - 1 );
+
+		// ranges starting inside a block and crossing into the next one
+		std::vector< TrajectoryArchive::Frame > part( 40 );
+		CHECK( archive.read( eventFrame - 20, 40, part.data() ) == 40 );
+		bool samePart = true;
+		for ( int i = 0; i < 40; i++ )
+			samePart = samePart && sameFrame( part[i], frames[eventFrame - 20 + i] );
+		CHECK( samePart );
+		CHECK( archive.read( numFrames - 5, 40, part.data() ) == 5 );
+		CHECK( sameFrame( part[4], frames[numFrames - 1] ) );
+		CHECK( archive.read( numFrames, 1, part.data() ) == 0 );
+		archive.close();
+
+		// a recording cut in its last block, before the index was written, reads up to the block before
+		CHECK( copyPrefix( path, cutPath, fileSize( path ) * 3 / 4 ) );
+		TrajectoryArchive cut;
+		CHECK( cut.open( cutPath ) );
+		CHECK( cut.recovered() );
+		const int recovered = cut.frame_count();
+		CHECK( recovered > 0 && recovered < numFrames );
+		std::vector< TrajectoryArchive::Frame > cutFrames( numFrames );
+		CHECK( cut.read( 0, numFrames, cutFrames.data() ) == recovered );
+		bool samePrefix = true;
+		for ( int frame = 0; frame < recovered; frame++ )
+			samePrefix = samePrefix && sameFrame( cutFrames[frame], frames[frame] );
+		CHECK( samePrefix );
+		cut.close();
+
+		std::remove( path );
+		std::remove( cutPath );
+	}
+}
+
+
+int main()
+{
+	Physics::init();
+	testShotCache();
+	testAiming();
+	testJobDependencies();
+	testParallelDeterminism();
+	testTrajectoryArchive();
+	testFixedPointChecksum();
+	testPhysicsEvents();
+	if ( failures )
+		std::fprintf( stderr, "%d failed\n", failures );
+	else
+		std::printf( "all passed\n" );
+	return failures;
+}
@@ -0,0 +1,248 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "../framework/jobs.hpp"
+#include "../game_cpp/params.hpp"
+#include "../game_cpp/physics.hpp"
+#include "../game_cpp/batch_physics.hpp"
+#include "../game_cpp/opening_book.hpp"
+
+
+//-------------------------------------------------------
+//	builds and inspects opening book files
+//
+//	usage: opening_book_tool build <file> [--angles N] [--speeds N] [--keep N] [--responses N] [--threads N]
+//	       opening_book_tool show <file>
+//
+//	build ranks a grid of cue shots from the opening layout, then from the resting positions
+//	of the best breaks, so a bot following the book finds its answer after the break too.
+//-------------------------------------------------------
+
+namespace
+{
+	struct Options
+	{
+		int angles = 720;
+		int speeds = 8;
+		int keep = 32;
+		int responses = 16;
+		int threads = -1;
+	};
+
+
+	constexpr float dt = 1.f / Params::System::targetFPS;
+	constexpr int maxSteps = 120 * Params::System::targetFPS;
+	constexpr float minSpeed = 1.5f;
+	constexpr float maxSpeed = Params::Shot::maxSpeed;
+
+
+	struct Candidate
+	{
+		OpeningBook::Shot shot;
+		int steps;
+		int index;
+		Physics::State rest;
+	};
+
+
+	int countBits( uint32_t mask )
+	{
+		int count = 0;
+		for ( ; mask; mask &= mask - 1 )
+			count++;
+		return count;
+	}
+
+
+	// object balls pocketed by the shot, a scratch outweighs two of them
+	float scoreShot( uint32_t before, uint32_t after )
+	{
+		const uint32_t pocketed = after & ~before;
+		return float( countBits( pocketed & ~1u ) ) - ( ( pocketed & 1u ) ? 2.f : 0.f );
+	}
+
+
+	uint32_t scoredMask( Physics::State const& state )
+	{
+		uint32_t mask = 0;
+		for ( int i = 0; i < 7; i++ )
+			if ( state.scored[i] )
+				mask |= 1u << i;
+		return mask;
+	}
+
+
+	// every shot of the grid, best first; ties go to the shorter shot, then to grid order
+	std::vector< Candidate > rankShots( Physics::State const& state, Options const& options )
+	{
+		const int numShots = options.angles * options.speeds;
+		std::vector< Vector2 > grid( numShots );
+		// one speed per run of angles, so lanes of a batch stop at about the same time
+		for ( int s = 0; s < options.speeds; s++ )
+		{
+			const float speed = options.speeds > 1 ? minSpeed + ( maxSpeed - minSpeed ) * s / ( options.speeds - 1 ) : maxSpeed;
+			for ( int a = 0; a < options.angles; a++ )
+			{
+				const float angle = 6.2831853f * a / options.angles;
+				grid[s * options.angles + a] = Vector2( std::cos( angle ), std::sin( angle ) ) * speed;
+			}
+		}
+
+		const uint32_t before = scoredMask( state );
+		std::vector< Candidate > candidates( numShots );
+		const int numBatches = ( numShots + BatchPhysics::lanes - 1 ) / BatchPhysics::lanes;
+		Jobs::parallelFor( 0, numBatches, 4, [&]( int batch )
+		{
+			const int first = batch * BatchPhysics::lanes;
+			const int count = std::min( BatchPhysics::lanes, numShots - first );
+			BatchPhysics::Result results[BatchPhysics::lanes];
+			BatchPhysics::simulate_shots( state, &grid[first], count, dt, maxSteps, results );
+
+			for ( int k = 0; k < count; k++ )
+			{
+				Candidate& candidate = candidates[first + k];
+				candidate.index = first + k;
+				candidate.steps = results[k].steps;
+				candidate.rest = state;
+				candidate.rest.positions = results[k].positions;
+				candidate.rest.scored = results[k].scored;
+				candidate.shot.velocity_x = grid[first + k].x;
+				candidate.shot.velocity_y = grid[first + k].y;
+				candidate.shot.scored_mask = scoredMask( candidate.rest );
+				candidate.shot.score = scoreShot( before, candidate.shot.scored_mask );
+			}
+		} );
+
+		std::sort( candidates.begin(), candidates.end(), []( Candidate const& a, Candidate const& b )
+		{
+			if ( a.shot.score != b.shot.score )
+				return a.shot.score > b.shot.score;
+			if ( a.steps != b.steps )
+				return a.steps < b.steps;
+			return a.index < b.index;
+		} );
+		return candidates;
+	}
+
+
+	void addPosition( OpeningBook::Builder& builder, Physics::State const& state, std::vector< Candidate > const& ranked, int keep )
+	{
+		std::vector< OpeningBook::Shot > shots;
+		for ( int i = 0; i < keep && i < int( ranked.size() ); i++ )
+			shots.push_back( ranked[i].shot );
+		builder.add( state, shots );
+	}
+
+
+	bool readOptions( int argc, char** argv, int first, Options& options )
+	{
+		for ( int i = first; i < argc; i++ )
+		{
+			int* value = nullptr;
+			if ( !std::strcmp( argv[i], "--angles" ) )
+				value = &options.angles;
+			else if ( !std::strcmp( argv[i], "--speeds" ) )
+				value = &options.speeds;
+			else if ( !std::strcmp( argv[i], "--keep" ) )
+				value = &options.keep;
+			else if ( !std::strcmp( argv[i], "--responses" ) )
+				value = &options.responses;
+			else if ( !std::strcmp( argv[i], "--threads" ) )
+				value = &options.threads;
+			if ( !value || i + 1 >= argc )
+				return false;
+			*value = std::atoi( argv[++i] );
+		}
+		return options.angles > 0 && options.speeds > 0 && options.keep > 0 && options.responses >= 0;
+	}
+
+
+	int build( char const* path, Options const& options )
+	{
+		Jobs::init( options.threads );
+		Physics::init();
+		const auto startTime = std::chrono::steady_clock::now();
+
+		Physics::State opening;
+		Physics::reset( opening );
+		OpeningBook::Builder builder;
+
+		const std::vector< Candidate > breaks = rankShots( opening, options );
+		addPosition( builder, opening, breaks, options.keep );
+
+		// answers to the best breaks that leave the cue ball and something to pocket on the table
+		int numResponses = 0;
+		for ( Candidate const& candidate : breaks )
+		{
+			if ( numResponses >= options.responses )
+				break;
+			if ( candidate.rest.scored[0] || ( candidate.shot.scored_mask & 0x7e ) == 0x7e )
+				continue;
+			Physics::State rest = candidate.rest;
+			rest.speeds.fill( Vector2( 0, 0 ) );
+			addPosition( builder, rest, rankShots( rest, options ), options.keep );
+			numResponses++;
+		}
+
+		const bool written = builder.write( path );
+		const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - startTime ).count();
+		Jobs::deinit();
+
+		if ( !written )
+		{
+			std::fprintf( stderr, "can't write %s\n", path );
+			return 1;
+		}
+		std::printf( "%d positions, %d shots each ranked out of %d, in %.2f s\n",
+					 1 + numResponses, options.keep, options.angles * options.speeds, seconds );
+		return 0;
+	}
+
+
+	int show( char const* path )
+	{
+		const auto startTime = std::chrono::steady_clock::now();
+		OpeningBook book;
+		if ( !book.open( path ) )
+		{
+			std::fprintf( stderr, "%s is not an opening book\n", path );
+			return 1;
+		}
+		Physics::State opening;
+		Physics::reset( opening );
+		const OpeningBook::Shots shots = book.find( opening );
+		const double microseconds = std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - startTime ).count();
+
+		std::printf( "%d positions, opening layout found in %.1f us after open\n", book.position_count(), microseconds );
+		std::printf( "%4s %9s %9s %6s  %s\n", "rank", "vx", "vy", "score", "pocketed" );
+		int rank = 1;
+		for ( OpeningBook::Shot const& shot : shots )
+		{
+			std::printf( "%4d %9.4f %9.4f %6.1f ", rank++, shot.velocity_x, shot.velocity_y, shot.score );
+			for ( int i = 0; i < 7; i++ )
+				if ( ( shot.scored_mask >> i ) & 1 )
+					std::printf( " %d", i );
+			std::printf( "\n" );
+		}
+		return 0;
+	}
+}
+
+
+int main( int argc, char** argv )
+{
+	Options options;
+	if ( argc >= 3 && !std::strcmp( argv[1], "build" ) && readOptions( argc, argv, 3, options ) )
+		return build( argv[2], options );
+	if ( argc == 3 && !std::strcmp( argv[1], "show" ) )
+		return show( argv[2] );
+
+	std::fprintf( stderr, "usage: opening_book_tool build <file> [--angles N] [--speeds N] [--keep N] [--responses N] [--threads N]\n"
+						  "       opening_book_tool show <file>\n" );
+	return 1;
+}
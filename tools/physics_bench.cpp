@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include "../game_cpp/params.hpp"
+#include "../game_cpp/physics.hpp"
+#include "../game_cpp/fixed_physics.hpp"
+
+
+//-------------------------------------------------------
+//	times the float and fixed point steps on the same shots
+//
+//	usage: physics_bench [shots]
+//
+//	shots are spread around the cue ball of the opening layout. The fixed point checksum
+//	must be the same on every compiler, platform and build configuration.
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr float dt = 1.f / Params::System::targetFPS;
+	constexpr int maxSteps = 120 * Params::System::targetFPS;
+
+
+	struct Run
+	{
+		double seconds = 0.0;
+		long long steps = 0;
+		uint64_t checksum = 14695981039346656037ull;
+		std::vector< uint32_t > scoredMasks;
+	};
+
+
+	// FNV-1a over the bits of every final position
+	void addToChecksum( uint64_t& checksum, Physics::State const& state )
+	{
+		for ( Vector2 const& position : state.positions )
+		{
+			uint32_t bits[2];
+			std::memcpy( &bits[0], &position.x, sizeof( float ) );
+			std::memcpy( &bits[1], &position.y, sizeof( float ) );
+			for ( uint32_t word : bits )
+				for ( int byte = 0; byte < 4; byte++ )
+				{
+					checksum ^= ( word >> ( 8 * byte ) ) & 0xff;
+					checksum *= 1099511628211ull;
+				}
+		}
+	}
+
+
+	template< class Simulate >
+	Run run( std::vector< Vector2 > const& shots, Simulate const& simulate )
+	{
+		Run result;
+		Physics::State opening;
+		Physics::reset( opening );
+
+		const auto startTime = std::chrono::steady_clock::now();
+		for ( Vector2 const& shot : shots )
+		{
+			Physics::State state = opening;
+			state.speeds[0] = shot;
+			result.steps += simulate( state, dt, maxSteps );
+			addToChecksum( result.checksum, state );
+
+			uint32_t mask = 0;
+			for ( int i = 0; i < 7; i++ )
+				if ( state.scored[i] )
+					mask |= 1u << i;
+			result.scoredMasks.push_back( mask );
+		}
+		result.seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - startTime ).count();
+		return result;
+	}
+
+
+	void print( char const* name, Run const& result, size_t numShots )
+	{
+		std::printf( "%-24s %9.1f ms %10.0f shots/s %8.1f ns/step  checksum %016llx\n",
+					 name, result.seconds * 1e3, numShots / result.seconds, result.seconds * 1e9 / double( result.steps ),
+					 static_cast< unsigned long long >( result.checksum ) );
+	}
+}
+
+
+int main( int argc, char** argv )
+{
+	const int numShots = argc > 1 ? std::atoi( argv[1] ) : 2000;
+	if ( numShots <= 0 )
+	{
+		std::fprintf( stderr, "usage: physics_bench [shots]\n" );
+		return 1;
+	}
+
+	// both steps run on this thread, so they are timed on their arithmetic alone
+	Physics::init();
+
+	// integers divided by powers of two are exact in float, so every build feeds the same shots
+	std::vector< Vector2 > shots( numShots );
+	uint32_t random = 12345;
+	for ( Vector2& shot : shots )
+	{
+		random = random * 1664525u + 1013904223u;
+		shot.x = float( int( random >> 20 ) - 2048 ) / 512.f;
+		random = random * 1664525u + 1013904223u;
+		shot.y = float( int( random >> 20 ) - 2048 ) / 1024.f;
+	}
+
+	const Run physics = run( shots, Physics::simulate_to_rest );
+	const Run fixed = run( shots, FixedPhysics::simulate_to_rest );
+
+	print( MINIBILL_FIXED_POINT_PHYSICS ? "Physics (fixed point)" : "Physics (float)", physics, shots.size() );
+	print( "FixedPhysics", fixed, shots.size() );
+
+	int samePocketed = 0;
+	for ( int i = 0; i < numShots; i++ )
+		if ( physics.scoredMasks[i] == fixed.scoredMasks[i] )
+			samePocketed++;
+	std::printf( "same balls pocketed in %d of %d shots, fixed point takes %.2fx the time\n",
+				 samePocketed, numShots, fixed.seconds / physics.seconds );
+
+	return 0;
+}
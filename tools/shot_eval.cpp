@@ -0,0 +1,390 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "../framework/jobs.hpp"
+#include "../game_cpp/params.hpp"
+#include "../game_cpp/physics.hpp"
+#include "../game_cpp/batch_physics.hpp"
+
+
+//-------------------------------------------------------
+//	simulates shots to rest, streaming records in and outcomes out
+//
+//	usage: shot_eval [--binary] [--interactive] [--threads N] [--max-steps N] [input [output]]
+//
+//	text input, one record per line:
+//		x0 y0 x1 y1 ... x6 y6 vx vy
+//	positions are in table units around its center, ball 0 is the cue ball, a pocketed ball is written as "- -", (vx, vy) is the cue ball velocity.
+//	text output, one line per record in input order:
+//		x0 y0 ... x6 y6 steps seconds
+//	with "- -" for balls pocketed at the end, or "invalid" for a record that couldn't be parsed.
+//
+//	binary records are little endian InputRecord / OutputRecord below, a truncated last record is an error.
+//
+//	Records are read and simulated in large batches. With --interactive, the default when reading a terminal,
+//	every record is answered and flushed before the next one is read, so the tool can be driven line by line.
+//-------------------------------------------------------
+
+namespace
+{
+	struct InputRecord
+	{
+		float positions[14];
+		uint32_t scoredMask;
+		float shot[2];
+	};
+
+
+	struct OutputRecord
+	{
+		float positions[14];
+		uint32_t scoredMask;
+		uint32_t steps;
+		float seconds;
+	};
+
+
+	struct Options
+	{
+		bool binary = false;
+		bool interactive = false;
+		int threads = -1;
+		int maxSteps = 120 * Params::System::targetFPS;
+		const char* input = nullptr;
+		const char* output = nullptr;
+	};
+
+
+	constexpr int recordsPerBatch = 4096;
+	constexpr int recordsPerJob = 64;
+	constexpr float dt = 1.f / Params::System::targetFPS;
+
+
+	// fixed size, so memory stays bounded however long the stream is
+	struct Batch
+	{
+		std::vector< InputRecord > inputs = std::vector< InputRecord >( recordsPerBatch );
+		std::vector< bool > valid = std::vector< bool >( recordsPerBatch );
+		std::vector< OutputRecord > outputs = std::vector< OutputRecord >( recordsPerBatch );
+		int count = 0;
+	};
+
+
+	bool parseOptions( int argc, char** argv, Options& options )
+	{
+		for ( int i = 1; i < argc; i++ )
+		{
+			if ( !std::strcmp( argv[i], "--binary" ) )
+				options.binary = true;
+			else if ( !std::strcmp( argv[i], "--interactive" ) )
+				options.interactive = true;
+			else if ( !std::strcmp( argv[i], "--threads" ) && i + 1 < argc )
+				options.threads = std::atoi( argv[++i] );
+			else if ( !std::strcmp( argv[i], "--max-steps" ) && i + 1 < argc )
+				options.maxSteps = std::atoi( argv[++i] );
+			else if ( argv[i][0] == '-' && argv[i][1] )
+				return false;
+			else if ( !options.input )
+				options.input = argv[i];
+			else if ( !options.output )
+				options.output = argv[i];
+			else
+				return false;
+		}
+		return true;
+	}
+
+
+	bool parseLine( const char* line, InputRecord& record )
+	{
+		record.scoredMask = 0;
+		const char* cursor = line;
+		auto next = [&cursor]( float& value, bool& missing ) -> bool
+		{
+			while ( *cursor == ' ' || *cursor == '\t' )
+				cursor++;
+			missing = cursor[0] == '-' && ( cursor[1] == ' ' || cursor[1] == '\t' || cursor[1] == '\n' || cursor[1] == '\r' || cursor[1] == 0 );
+			if ( missing )
+			{
+				cursor++;
+				value = 0.f;
+				return true;
+			}
+			char* end = nullptr;
+			value = std::strtof( cursor, &end );
+			if ( end == cursor )
+				return false;
+			cursor = end;
+			return true;
+		};
+
+		for ( int i = 0; i < 7; i++ )
+		{
+			bool missingX, missingY;
+			if ( !next( record.positions[2 * i], missingX ) || !next( record.positions[2 * i + 1], missingY ) || missingX != missingY )
+				return false;
+			if ( missingX )
+				record.scoredMask |= 1u << i;
+		}
+
+		bool missing;
+		if ( !next( record.shot[0], missing ) || missing || !next( record.shot[1], missing ) || missing )
+			return false;
+
+		// a record is exactly 16 values, anything after them makes the line invalid
+		while ( *cursor == ' ' || *cursor == '\t' || *cursor == '\r' )
+			cursor++;
+		return *cursor == 0;
+	}
+
+
+	struct Input
+	{
+		Input( std::istream& stream, bool binary, int batchSize ) : stream( stream ), binary( binary ), batchSize( batchSize ) {}
+
+		std::istream& stream;
+		bool binary;
+		// records per batch, one when interactive
+		int batchSize;
+		int lineNumber = 0;
+		// bytes of an incomplete binary record left at the end
+		int truncatedBytes = 0;
+		std::string line;
+	};
+
+
+	// returns false at the end of input
+	bool readBatch( Input& input, Batch& batch )
+	{
+		batch.count = 0;
+		if ( input.binary )
+		{
+			const std::streamsize bytes = std::streamsize( input.batchSize * sizeof( InputRecord ) );
+			input.stream.read( reinterpret_cast< char* >( batch.inputs.data() ), bytes );
+			const std::streamsize read = input.stream.gcount();
+			batch.count = int( read / std::streamsize( sizeof( InputRecord ) ) );
+			// only the last read can stop inside a record
+			input.truncatedBytes += int( read % std::streamsize( sizeof( InputRecord ) ) );
+			std::fill( batch.valid.begin(), batch.valid.begin() + batch.count, true );
+			return batch.count > 0;
+		}
+
+		while ( batch.count < input.batchSize && std::getline( input.stream, input.line ) )
+		{
+			input.lineNumber++;
+			const size_t first = input.line.find_first_not_of( " \t\r" );
+			if ( first == std::string::npos || input.line[first] == '#' )
+				continue;
+			batch.valid[batch.count] = parseLine( input.line.c_str() + first, batch.inputs[batch.count] );
+			if ( !batch.valid[batch.count] )
+				std::fprintf( stderr, "line %d: invalid record\n", input.lineNumber );
+			batch.count++;
+		}
+		return batch.count > 0;
+	}
+
+
+	bool isTerminal( FILE* file )
+	{
+#ifdef _WIN32
+		return _isatty( _fileno( file ) ) != 0;
+#else
+		return isatty( fileno( file ) ) != 0;
+#endif
+	}
+
+
+	Physics::State toState( InputRecord const& record )
+	{
+		Physics::State state;
+		Physics::reset( state );
+		for ( int i = 0; i < 7; i++ )
+		{
+			state.positions[i] = Vector2( record.positions[2 * i], record.positions[2 * i + 1] );
+			state.scored[i] = ( record.scoredMask >> i ) & 1;
+		}
+		return state;
+	}
+
+
+	bool sameTable( InputRecord const& a, InputRecord const& b )
+	{
+		return a.scoredMask == b.scoredMask && !std::memcmp( a.positions, b.positions, sizeof( a.positions ) );
+	}
+
+
+	// consecutive shots from the same table share one SIMD batch
+	void simulateRange( Batch& batch, int begin, int end, int maxSteps )
+	{
+		int i = begin;
+		while ( i < end )
+		{
+			if ( !batch.valid[i] )
+			{
+				i++;
+				continue;
+			}
+
+			int count = 1;
+			while ( count < BatchPhysics::lanes && i + count < end && batch.valid[i + count] && sameTable( batch.inputs[i], batch.inputs[i + count] ) )
+				count++;
+
+			Vector2 shots[BatchPhysics::lanes];
+			BatchPhysics::Result results[BatchPhysics::lanes];
+			for ( int k = 0; k < count; k++ )
+				shots[k] = Vector2( batch.inputs[i + k].shot[0], batch.inputs[i + k].shot[1] );
+			BatchPhysics::simulate_shots( toState( batch.inputs[i] ), shots, count, dt, maxSteps, results );
+
+			for ( int k = 0; k < count; k++ )
+			{
+				OutputRecord& output = batch.outputs[i + k];
+				output.scoredMask = 0;
+				for ( int ball = 0; ball < 7; ball++ )
+				{
+					output.positions[2 * ball] = results[k].positions[ball].x;
+					output.positions[2 * ball + 1] = results[k].positions[ball].y;
+					if ( results[k].scored[ball] )
+						output.scoredMask |= 1u << ball;
+				}
+				output.steps = uint32_t( results[k].steps );
+				output.seconds = results[k].steps * dt;
+			}
+			i += count;
+		}
+	}
+
+
+	void writeBatch( FILE* output, bool binary, Batch const& batch )
+	{
+		for ( int i = 0; i < batch.count; i++ )
+		{
+			if ( !batch.valid[i] )
+			{
+				if ( !binary )
+					std::fputs( "invalid\n", output );
+				continue;
+			}
+
+			OutputRecord const& record = batch.outputs[i];
+			if ( binary )
+			{
+				std::fwrite( &record, sizeof( record ), 1, output );
+				continue;
+			}
+			for ( int ball = 0; ball < 7; ball++ )
+			{
+				if ( ( record.scoredMask >> ball ) & 1 )
+					std::fputs( "- - ", output );
+				else
+					std::fprintf( output, "%.6g %.6g ", record.positions[2 * ball], record.positions[2 * ball + 1] );
+			}
+			std::fprintf( output, "%u %.4f\n", record.steps, record.seconds );
+		}
+	}
+
+
+	struct SimulateJob
+	{
+		Batch* batch;
+		int maxSteps;
+	};
+
+
+	void simulateJob( void* context, int begin, int end )
+	{
+		SimulateJob const& job = *static_cast< SimulateJob const* >( context );
+		simulateRange( *job.batch, begin, end, job.maxSteps );
+	}
+}
+
+
+int main( int argc, char** argv )
+{
+	Options options;
+	if ( !parseOptions( argc, argv, options ) )
+	{
+		std::fprintf( stderr, "usage: shot_eval [--binary] [--interactive] [--threads N] [--max-steps N] [input [output]]\n" );
+		return 1;
+	}
+
+	std::ios::sync_with_stdio( false );
+	std::ifstream inputFile;
+	if ( options.input )
+		inputFile.open( options.input, options.binary ? std::ios::in | std::ios::binary : std::ios::in );
+	FILE* output = options.output ? std::fopen( options.output, options.binary ? "wb" : "w" ) : stdout;
+	if ( ( options.input && !inputFile.is_open() ) || !output )
+	{
+		std::fprintf( stderr, "can't open %s\n", !output ? options.output : options.input );
+		return 1;
+	}
+#ifdef _WIN32
+	if ( options.binary )
+	{
+		_setmode( _fileno( stdin ), _O_BINARY );
+		_setmode( _fileno( output ), _O_BINARY );
+	}
+#endif
+	const bool interactive = options.interactive || ( !options.input && isTerminal( stdin ) );
+	Input input( options.input ? static_cast< std::istream& >( inputFile ) : std::cin, options.binary, interactive ? 1 : recordsPerBatch );
+	static char outputBuffer[1 << 16];
+	std::setvbuf( output, outputBuffer, _IOFBF, sizeof( outputBuffer ) );
+
+	Jobs::init( options.threads );
+	Physics::init();
+
+	const auto startTime = std::chrono::steady_clock::now();
+	long long numShots = 0;
+
+	// while one batch is simulated on the workers the next one is read, unless the next record waits for this answer
+	Batch batches[2];
+	int current = 0;
+	bool hasInput = readBatch( input, batches[current] );
+	while ( hasInput )
+	{
+		Batch& batch = batches[current];
+		SimulateJob context = { &batch, options.maxSteps };
+		Jobs::Job* job = Jobs::createParallelJob( simulateJob, &context, 0, batch.count, recordsPerJob );
+		Jobs::submit( job );
+
+		if ( !interactive )
+			hasInput = readBatch( input, batches[1 - current] );
+
+		Jobs::wait( job );
+		writeBatch( output, options.binary, batch );
+		for ( int i = 0; i < batch.count; i++ )
+			numShots += batch.valid[i] ? 1 : 0;
+		current = 1 - current;
+
+		if ( interactive )
+		{
+			std::fflush( output );
+			hasInput = readBatch( input, batches[current] );
+		}
+	}
+	std::fflush( output );
+	if ( input.truncatedBytes )
+		std::fprintf( stderr, "input ends with a truncated record of %d bytes\n", input.truncatedBytes );
+
+	const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - startTime ).count();
+	std::fprintf( stderr, "%lld shots in %.2f s, %.0f shots/s on %d worker threads\n",
+				  numShots, seconds, seconds > 0.0 ? numShots / seconds : 0.0, Jobs::workerCount() );
+
+	Jobs::deinit();
+	if ( options.output )
+		std::fclose( output );
+	return input.truncatedBytes ? 1 : 0;
+}
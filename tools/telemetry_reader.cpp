@@ -0,0 +1,84 @@
+#define NOMINMAX
+#include <windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "../framework/telemetry.hpp"
+
+
+//-------------------------------------------------------
+//	prints live telemetry of every running game instance
+//	usage: telemetry_reader [refresh interval in ms [number of samples]]
+//	without a number of samples it prints until interrupted
+//-------------------------------------------------------
+
+namespace
+{
+	void printSamples( Telemetry::Segment const& segment )
+	{
+		std::printf( "\n%8s %10s %10s %10s %12s %12s %6s\n", "pid", "frame", "steps", "frame ms", "jitter ms", "max jit ms", "balls" );
+
+		int instances = 0;
+		for ( Telemetry::Slot const& slot : segment.slots )
+		{
+			Telemetry::Sample sample;
+			if ( !Telemetry::readSlot( slot, sample ) )
+				continue;
+
+			instances++;
+			std::printf( "%8u %10llu %10llu %10.2f %12.2f %12.2f %6u\n",
+						 sample.ownerProcessId,
+						 static_cast< unsigned long long >( sample.frame ),
+						 static_cast< unsigned long long >( sample.simulationSteps ),
+						 sample.frameTimeMicroseconds / 1000.0,
+						 sample.jitterMicroseconds / 1000.0,
+						 sample.maxJitterMicroseconds / 1000.0,
+						 sample.activeBalls );
+		}
+
+		if ( !instances )
+			std::printf( "no running instances\n" );
+	}
+}
+
+
+int main( int argc, char** argv )
+{
+	const DWORD refreshInterval = argc > 1 ? DWORD( std::atoi( argv[1] ) ) : 1000;
+	const int numSamples = argc > 2 ? std::atoi( argv[2] ) : 0;
+
+	HANDLE mappingHandle = OpenFileMappingA( FILE_MAP_READ, FALSE, Telemetry::segmentName );
+	if ( !mappingHandle )
+	{
+		std::printf( "no telemetry segment, is the game running?\n" );
+		return 1;
+	}
+
+	const void* view = MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, sizeof( Telemetry::Segment ) );
+	if ( !view )
+	{
+		CloseHandle( mappingHandle );
+		return 1;
+	}
+
+	Telemetry::Segment const& segment = *static_cast< Telemetry::Segment const* >( view );
+	if ( segment.magic.load() != Telemetry::segmentMagic || segment.version.load() != Telemetry::segmentVersion )
+	{
+		std::printf( "unknown telemetry segment version\n" );
+		UnmapViewOfFile( view );
+		CloseHandle( mappingHandle );
+		return 1;
+	}
+
+	for ( int sample = 0; numSamples <= 0 || sample < numSamples; sample++ )
+	{
+		if ( sample > 0 )
+			Sleep( refreshInterval );
+		printSamples( segment );
+	}
+
+	UnmapViewOfFile( view );
+	CloseHandle( mappingHandle );
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../game_cpp/trajectory_archive.hpp"
+
+
+//-------------------------------------------------------
+//	prints recorded trajectories
+//
+//	usage: trajectory_dump <archive> [from_seconds [to_seconds]]
+//
+//	one line per frame between the two times:
+//		time x0 y0 ... x6 y6
+//	with "- -" for balls off the table. Only the blocks covering the range are decoded.
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr int framesPerRead = 1024;
+}
+
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 || argc > 4 )
+	{
+		std::fprintf( stderr, "usage: trajectory_dump <archive> [from_seconds [to_seconds]]\n" );
+		return 1;
+	}
+
+	TrajectoryArchive archive;
+	if ( !archive.open( argv[1] ) )
+	{
+		std::fprintf( stderr, "can't open %s\n", argv[1] );
+		return 1;
+	}
+
+	const double from = argc > 2 ? std::atof( argv[2] ) : 0.0;
+	const double to = argc > 3 ? std::atof( argv[3] ) : archive.duration();
+	std::fprintf( stderr, "%d frames, %.2f s%s\n", archive.frame_count(), archive.duration(),
+				  archive.recovered() ? ", recovered from an unclosed recording" : "" );
+
+	std::vector< TrajectoryArchive::Frame > frames( framesPerRead );
+	int first = archive.frame_at( from );
+	while ( first < archive.frame_count() )
+	{
+		const int count = archive.read( first, framesPerRead, frames.data() );
+		if ( count == 0 )
+		{
+			std::fprintf( stderr, "frame %d: corrupted block\n", first );
+			return 1;
+		}
+		for ( int i = 0; i < count; i++ )
+		{
+			TrajectoryArchive::Frame const& frame = frames[i];
+			if ( frame.time > to )
+				return 0;
+			if ( frame.time < from )
+				continue;
+			std::printf( "%.6f", frame.time );
+			for ( int ball = 0; ball < 7; ball++ )
+			{
+				if ( frame.scored[ball] )
+					std::printf( " - -" );
+				else
+					std::printf( " %.4f %.4f", frame.positions[ball].x, frame.positions[ball].y );
+			}
+			std::printf( "\n" );
+		}
+		first += count;
+	}
+	return 0;
+}